@@ -0,0 +1,259 @@
+#!/bin/bash
+
+set -eo pipefail
+
+# This script searches the tuning structures of the C++/Noarr kernels for the fastest configuration on this machine
+# usage: ./autotune.sh [KERNEL]...  (all kernels with a tuning structure by default)
+#
+# The candidates of each field of a tuning structure are derived from its default value:
+#   - the permutations of the dimensions of a layout (`j_vec ^ i_vec`) or of a traversal order (`block_j ^ block_i`)
+#   - a traversal of a `block_<dim>` field split into blocks of each of $BLOCK_SIZES (`noarr::into_blocks` with the blocks hoisted)
+#   - a quarter, a half, twice and four times a size, the other value of a flag
+#
+# The fields are tuned one at a time (coordinate descent, $PASSES times over all fields); each candidate is compiled
+# with its tuning header (see TUNING_DIR in CMakeLists.txt), validated against the checksum of the default configuration
+# (with the relative $TOLERANCE) and measured in-process (the median of $NUM_RUNS runs). The best configuration is stored
+# as $TUNING_DIR/$MACHINE/<dataset>.<type>/<kernel>.hpp, so that the directory can be passed to CMake as TUNING_DIR
+
+export BUILD_DIR=${BUILD_DIR:-build}
+export DATASET_SIZE=${DATASET_SIZE:-EXTRALARGE}
+export DATA_TYPE=${DATA_TYPE:-FLOAT}
+export TUNING_DIR=${TUNING_DIR:-tuning-results}
+export NUM_RUNS=${NUM_RUNS:-5}
+export PASSES=${PASSES:-1}
+export BLOCK_SIZES=${BLOCK_SIZES:-"16 32 64 128"}
+export TOLERANCE=${TOLERANCE:-1e-5}
+export CXX=${CXX:-c++}
+export TUNE_CXXFLAGS=${TUNE_CXXFLAGS:-"-O3 -DNDEBUG -fopenmp"}
+export NOARR_INCLUDE=${NOARR_INCLUDE:-$BUILD_DIR/_deps/noarr-src/include}
+
+# the machines of a cluster partition share the CPU model, so the results are shared among them
+if [ -z "$MACHINE" ]; then
+	MACHINE=$(sed -n 's/^model name[^:]*: *//p' /proc/cpuinfo 2>/dev/null | head -n 1 | tr -cs 'A-Za-z0-9' '-' | sed 's/-$//')
+	MACHINE=${MACHINE:-$(hostname -s)}
+fi
+
+if [ ! -d "$NOARR_INCLUDE" ]; then
+	echo "Noarr Structures not found in $NOARR_INCLUDE (run ./build.sh first or set NOARR_INCLUDE)" >&2
+	exit 1
+fi
+
+dirname=$(mktemp -d)
+
+cleanup() {
+	echo "deleting $dirname" >&2
+	rm -rf "$dirname"
+}
+
+trap cleanup EXIT
+
+# prints the permutations of the given words, one per line, the identity first
+permutations() {
+	if [ "$#" -le 1 ]; then
+		echo "$*"
+		return
+	fi
+
+	local i
+	for ((i = 1; i <= $#; i++)); do
+		local rest=("${@:1:i-1}" "${@:i+1}")
+
+		permutations "${rest[@]}" | while read -r perm; do
+			echo "${!i} $perm"
+		done
+	done
+}
+
+# prints the candidate values of a tuning field, one per line, the default first
+candidates() {
+	local name="$1"
+	local value="$2"
+
+	echo "$value"
+
+	if [[ "$value" =~ ^[a-z0-9_]+( \^ [a-z0-9_]+)+$ ]]; then
+		# a layout or a traversal order
+		# shellcheck disable=SC2086
+		permutations ${value//^/} | tail -n +2 | sed 's/ / ^ /g'
+	elif [[ "$name" =~ ^block_[a-z] ]] && [[ "$value" = "noarr::neutral_proto()" || "$value" =~ ^noarr::hoist\<\'[a-z]\'\>\(\)$ ]]; then
+		local dim="${name:6:1}"
+		local major="${dim^^}"
+		local size
+
+		for size in $BLOCK_SIZES; do
+			echo "noarr::into_blocks<'$dim', '$major', '$dim'>($size) ^ noarr::hoist<'$major'>()"
+		done
+	elif [[ "$value" =~ ^\(std::size_t\)([0-9]+)$ ]]; then
+		local size="${BASH_REMATCH[1]}"
+		local factor
+
+		for factor in "/4" "/2" "*2" "*4"; do
+			if [ $((size $factor)) -ge 1 ]; then
+				echo "(std::size_t)$((size $factor))"
+			fi
+		done
+	elif [ "$value" = "false" ]; then
+		echo "true"
+	elif [ "$value" = "true" ]; then
+		echo "false"
+	fi
+}
+
+# prints the fields of the tuning structure of the source as `name<TAB>value<TAB>macro` lines
+tuning_fields() {
+	sed -n '/^struct tuning {/,/^} tuning;/p' "$1" |
+	sed -nE 's/^\t(DEFINE_PROTO_STRUCT|AUTO_FIELD)\(([a-z0-9_]+), (.*)\);$/\2\t\3\t\1/p'
+}
+
+# prints the tuning header (the body of the tuning structure) of the given configuration (see tuning_fields)
+tuning_header() {
+	awk -F '\t' '{ print "\t" $3 "(" $1 ", " $2 ");" }' "$1"
+}
+
+# compiles the kernel with the given configuration; prints nothing and fails if it does not compile
+compile() {
+	local source="$1"
+	local config="$2"
+	local binary="$3"
+
+	rm -f "$binary"
+	tuning_header "$config" > "$binary.hpp"
+
+	# shellcheck disable=SC2086
+	"$CXX" -std=c++20 $TUNE_CXXFLAGS -D"${DATASET_SIZE}_DATASET" -DDATA_TYPE_IS_"$DATA_TYPE" -DTUNING_HEADER="\"$binary.hpp\"" \
+		-Iinclude -I"$NOARR_INCLUDE" "$source" -o "$binary" < /dev/null 2> "$binary.log"
+}
+
+# prints the median run time of the binary, or nothing if its results differ from the reference checksum
+measure() {
+	local binary="$1"
+	local reference="$2"
+
+	rm -f "$binary.json"
+
+	POLYBENCH_RUNS="$NUM_RUNS" POLYBENCH_WARMUP=1 POLYBENCH_FORMAT=json POLYBENCH_OUTPUT="$binary.json" \
+	POLYBENCH_RESULT_FORMAT=checksum POLYBENCH_RESULT_FILE="$binary.checksum" \
+	POLYBENCH_REFERENCE="$reference" POLYBENCH_TOLERANCE="$TOLERANCE" \
+		"$binary" < /dev/null > /dev/null 2> "$binary.err" || return 0
+
+	sed -n 's/.*"median":\([^,}]*\).*/\1/p' "$binary.json"
+}
+
+tune() {
+	local kernel="$1"
+	local source="$2"
+	local work="$dirname/$kernel"
+	local result="$TUNING_DIR/$MACHINE/$DATASET_SIZE.$DATA_TYPE/$kernel.hpp"
+
+	mkdir -p "$work"
+
+	tuning_fields "$source" > "$work/best"
+
+	if [ ! -s "$work/best" ]; then
+		echo "$kernel has no tuning structure" >&2
+		return
+	fi
+
+	echo "Tuning $kernel"
+
+	if ! compile "$source" "$work/best" "$work/default"; then
+		cat "$work/default.log" >&2
+		echo "cannot compile $kernel" >&2
+		return
+	fi
+
+	# the default configuration provides the reference results
+	POLYBENCH_RESULT_FORMAT=checksum POLYBENCH_RESULT_FILE="$work/reference" "$work/default" < /dev/null > /dev/null 2>&1
+
+	local default_time best_time
+	default_time=$(measure "$work/default" "$work/reference")
+	best_time="$default_time"
+
+	if [ -z "$default_time" ]; then
+		cat "$work/default.err" >&2
+		echo "cannot measure $kernel" >&2
+		return
+	fi
+
+	echo "	default: $default_time"
+
+	local pass name value macro
+	for ((pass = 0; pass < PASSES; pass++)); do
+		# the fields of the best configuration at the start of the pass
+		cp "$work/best" "$work/fields"
+
+		while IFS=$'\t' read -r name value macro; do
+			local candidate=0
+			local pids=()
+
+			# the candidates of a field are compiled in parallel
+			while read -r alternative; do
+				[ "$alternative" = "$value" ] && continue
+
+				candidate=$((candidate + 1))
+
+				awk -F '\t' -v name="$name" -v value="$alternative" \
+					'BEGIN { OFS = FS } $1 == name { $2 = value } { print }' "$work/best" > "$work/$name.$candidate.config"
+
+				compile "$source" "$work/$name.$candidate.config" "$work/$name.$candidate" &
+				pids+=($!)
+			done < <(candidates "$name" "$value")
+
+			local pid
+			for pid in "${pids[@]}"; do
+				wait "$pid" || true
+			done
+
+			local i time
+			for ((i = 1; i <= candidate; i++)); do
+				local binary="$work/$name.$i"
+				local alternative
+				alternative=$(awk -F '\t' -v name="$name" '$1 == name { print $2 }' "$binary.config")
+
+				if [ ! -x "$binary" ]; then
+					echo "	$name = $alternative: does not compile" >&2
+					continue
+				fi
+
+				time=$(measure "$binary" "$work/reference")
+
+				if [ -z "$time" ]; then
+					echo "	$name = $alternative: failed or wrong results" >&2
+					continue
+				fi
+
+				echo "	$name = $alternative: $time"
+
+				if awk -v a="$time" -v b="$best_time" 'BEGIN { exit !(a < b) }'; then
+					best_time="$time"
+					cp "$binary.config" "$work/best"
+				fi
+			done
+		done < "$work/fields"
+	done
+
+	mkdir -p "$(dirname "$result")"
+
+	{
+		echo "// autotuned on $MACHINE: median $best_time s (default configuration: $default_time s)"
+		tuning_header "$work/best"
+	} > "$result"
+
+	echo "	best: $best_time -> $result"
+}
+
+kernels=$(sed -nE 's/^add_kernel\(([^ ]+) ([^ )]+)\)$/\1 \2/p' CMakeLists.txt)
+
+echo "$kernels" | while read -r kernel source; do
+	if [ "$#" -gt 0 ]; then
+		case " $* " in
+			*" $kernel "*)
+				;;
+			*)
+				continue
+				;;
+		esac
+	fi
+
+	tune "$kernel" "$source"
+done
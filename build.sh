@@ -7,10 +7,19 @@ cd build
 export DATASET_SIZE=${DATASET_SIZE:-EXTRALARGE}
 export DATA_TYPE=${DATA_TYPE:-FLOAT}
 export NOARR_STRUCTURES_BRANCH=${NOARR_STRUCTURES_BRANCH:-main}
+export TUNING_DIR=${TUNING_DIR:-}
+export HUGE_PAGES=${HUGE_PAGES:-off}
+
+# relative to the repository root
+if [ -n "$TUNING_DIR" ]; then
+    TUNING_DIR=$(cd .. && realpath "$TUNING_DIR")
+fi
 
 # Configure the build
 cmake -DCMAKE_BUILD_TYPE=Release \
     -DNOARR_STRUCTURES_BRANCH="$NOARR_STRUCTURES_BRANCH" \
+    -DTUNING_DIR="$TUNING_DIR" \
+    -DHUGE_PAGES="$HUGE_PAGES" \
     -DCMAKE_CXX_FLAGS="${CMAKE_CXX_FLAGS} -D${DATASET_SIZE}_DATASET -DDATA_TYPE_IS_$DATA_TYPE" \
     ..
 
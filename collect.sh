@@ -6,6 +6,17 @@ export DATA_TYPE=${DATA_TYPE:-FLOAT}
 export NOARR_STRUCTURES_BRANCH=${NOARR_STRUCTURES_BRANCH:-main}
 export USE_SLURM=${USE_SLURM:-0}
 export DATA_DIR=${DATA_DIR:-data}
+export FORMAT=${FORMAT:-text}
+export NUM_RUNS=${NUM_RUNS:-10}
+
+# thread placement (see include/affinity.hpp), unpinned by default; if the Noarr implementation is pinned,
+# the baseline is pinned by taskset to the CPU of its main thread (reported by the Noarr run)
+export AFFINITY=${AFFINITY:-none}
+export CORES=${CORES:-}
+export SMT=${SMT:-on}
+export POLYBENCH_AFFINITY="$AFFINITY"
+export POLYBENCH_CORES="$CORES"
+export POLYBENCH_SMT="$SMT"
 
 # SLURM settings (if used)
 export SLURM_ACCOUNT=${SLURM_ACCOUNT:-kdss}
@@ -40,9 +51,25 @@ find "$BUILD_DIR" -maxdepth 1 -executable -type f |
 while read -r file; do
     filename=$(basename "$file")
 
+    # the multi-kernel driver and the comparator are not kernels
+    [ "$filename" = "polybench-noarr" ] && continue
+    [ "$filename" = "polybench-compare" ] && continue
+
     echo "collecting $filename"
-    ( run_script ./run_noarr_algorithm.sh "Noarr" "$BUILD_DIR/$filename" & wait ) > "$DATA_DIR/$filename.log"
+
+    # structured reports (json/csv) of the Noarr implementation only, measured in-process
+    if [ "$FORMAT" != "text" ]; then
+        ( run_script env POLYBENCH_FORMAT="$FORMAT" POLYBENCH_RUNS="$NUM_RUNS" POLYBENCH_WARMUP=1 "$BUILD_DIR/$filename" 2>&1 1>/dev/null & wait ) > "$DATA_DIR/$filename.$FORMAT"
+        echo "done"
+        continue
+    fi
+
+    cpu_file="$DATA_DIR/.$filename.cpu"
+    rm -f "$cpu_file"
+
+    ( run_script env CPU_FILE="$cpu_file" ./run_noarr_algorithm.sh "Noarr" "$BUILD_DIR/$filename" & wait ) > "$DATA_DIR/$filename.log"
 	echo "" >> "$DATA_DIR/$filename.log"
-    ( run_script ./run_c_algorithm.sh "Baseline" "$POLYBENCH_C_DIR/$BUILD_DIR/$filename" & wait ) >> "$DATA_DIR/$filename.log"
+    ( run_script env BASELINE_CPU="$(cat "$cpu_file" 2>/dev/null)" ./run_c_algorithm.sh "Baseline" "$POLYBENCH_C_DIR/$BUILD_DIR/$filename" & wait ) >> "$DATA_DIR/$filename.log"
+    rm -f "$cpu_file"
     echo "done"
 done
@@ -0,0 +1,475 @@
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "mapped_file.hpp"
+#include "params.hpp"
+
+namespace {
+
+// the type of the compared values; decides the meaning of a ULP
+enum class value_kind { integer, float32, float64 };
+
+struct values {
+	value_kind kind;
+	std::vector<double> data;
+};
+
+// accepted differences; two values match if they are within any of them
+struct tolerance {
+	double ulp = 0;
+	double rel = 0;
+	double abs = 0;
+};
+
+// error statistics of (a part of) the compared values
+struct errors {
+	std::size_t count = 0;
+	std::size_t mismatches = 0;
+
+	double max_abs = 0;
+	std::size_t max_abs_index = 0;
+	double max_rel = 0;
+	double max_ulp = 0;
+
+	// of the finite values and differences (a NaN or an infinity is reported by the others)
+	double diff_squares = 0;
+	double reference_squares = 0;
+
+	// the first mismatches, by index
+	std::vector<std::size_t> first;
+
+	void merge(const errors &other) {
+		if (other.max_abs > max_abs || std::isnan(other.max_abs)) {
+			max_abs = other.max_abs;
+			max_abs_index = other.max_abs_index;
+		}
+
+		count += other.count;
+		mismatches += other.mismatches;
+		max_rel = std::max(max_rel, other.max_rel);
+		max_ulp = std::max(max_ulp, other.max_ulp);
+		diff_squares += other.diff_squares;
+		reference_squares += other.reference_squares;
+		first.insert(first.end(), other.first.begin(), other.first.end());
+	}
+};
+
+constexpr std::size_t reported_mismatches = 10;
+
+// the smallest part of the work worth a thread (in values or bytes)
+constexpr std::size_t min_chunk = 1 << 16;
+
+// the exit status of errors (e.g. an unreadable file), unlike 1 of differing results
+constexpr int error_status = 2;
+
+[[noreturn]] void fail(const std::string &message) {
+	std::cerr << message << std::endl;
+	std::exit(error_status);
+}
+
+// runs fn(begin, end, thread) on `threads` parts of [0, n) in parallel
+void parallel_for(std::size_t threads, std::size_t n, auto &&fn) {
+	std::vector<std::thread> workers;
+
+	for (std::size_t t = 1; t < threads; ++t)
+		workers.emplace_back([&fn, t, threads, n] { fn(t * n / threads, (t + 1) * n / threads, t); });
+
+	fn(0, n / threads, 0);
+
+	for (auto &worker : workers)
+		worker.join();
+}
+
+bool is_space(char c) {
+	return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// extracts all the whitespace-separated tokens that are numbers (as in the text output of the kernels)
+values read_text(const char *text, std::size_t size, value_kind kind, std::size_t threads) {
+	threads = std::min(threads, size / min_chunk + 1);
+
+	// the chunks start at token boundaries
+	std::vector<std::size_t> bounds(threads + 1);
+
+	for (std::size_t t = 0; t <= threads; ++t) {
+		std::size_t bound = t * size / threads;
+
+		while (bound > 0 && bound < size && !is_space(text[bound - 1]))
+			++bound;
+
+		bounds[t] = bound;
+	}
+
+	std::vector<std::vector<double>> parts(threads);
+
+	// one chunk per thread
+	parallel_for(threads, threads, [&](std::size_t, std::size_t, std::size_t t) {
+		const char *ptr = text + bounds[t];
+		const char *const last = text + bounds[t + 1];
+
+		while (ptr < last) {
+			while (ptr < last && is_space(*ptr))
+				++ptr;
+
+			const char *token = ptr;
+
+			while (ptr < last && !is_space(*ptr))
+				++ptr;
+
+			if (token == ptr)
+				break;
+
+			double value;
+
+			// std::from_chars does not accept a leading '+'
+			if (*token == '+')
+				++token;
+
+			if (auto [end, ec] = std::from_chars(token, ptr, value); ec == std::errc() && end == ptr)
+				parts[t].push_back(value);
+		}
+	});
+
+	values result{kind, {}};
+
+	for (const auto &part : parts)
+		result.data.insert(result.data.end(), part.begin(), part.end());
+
+	return result;
+}
+
+template<class T>
+void convert(const char *data, std::size_t count, std::vector<double> &out, std::size_t threads) {
+	const std::size_t offset = out.size();
+
+	out.resize(offset + count);
+
+	parallel_for(std::min(threads, count / min_chunk + 1), count, [&](std::size_t begin, std::size_t end, std::size_t) {
+		for (std::size_t i = begin; i < end; ++i) {
+			T value;
+			std::memcpy(&value, data + i * sizeof(T), sizeof(T));
+			out[offset + i] = (double)value;
+		}
+	});
+}
+
+// reads a .npy array (see include/npy.hpp), or several stored one after another (as written before
+// each result got its own file); all arrays of a file must have the same type
+values read_npy(const char *data, std::size_t size, const std::string &path, std::size_t threads) {
+	const char little = std::endian::native == std::endian::little ? '<' : '>';
+
+	values result{value_kind::float64, {}};
+	std::size_t offset = 0;
+
+	while (offset < size) {
+		if (size - offset < 10 || std::memcmp(data + offset, "\x93NUMPY", 6) != 0)
+			fail("malformed .npy array in " + path);
+
+		const auto byte = [&](std::size_t i) { return (std::size_t)(unsigned char)data[offset + i]; };
+
+		// version 1.0 has a 2-byte header length, the later versions a 4-byte one
+		const bool v1 = byte(6) == 1;
+		const std::size_t preamble = v1 ? 10 : 12;
+		const std::size_t header_len = v1 ? byte(8) | byte(9) << 8 : byte(8) | byte(9) << 8 | byte(10) << 16 | byte(11) << 24;
+
+		if (size - offset < preamble + header_len)
+			fail("malformed .npy array in " + path);
+
+		const std::string_view header(data + offset + preamble, header_len);
+
+		const auto field = [&](std::string_view name) {
+			const auto pos = header.find(name);
+
+			if (pos == header.npos)
+				fail("malformed .npy header in " + path);
+
+			return header.substr(pos + name.size());
+		};
+
+		const std::string_view descr = field("'descr': '").substr(0, 3);
+		std::string_view shape = field("'shape': (");
+		shape = shape.substr(0, shape.find(')'));
+
+		if (descr.size() != 3 || (descr[0] != little && descr[0] != '|' && descr[0] != '='))
+			fail("unsupported .npy type '" + std::string(descr) + "' in " + path);
+
+		if (field("'fortran_order': ").starts_with("True"))
+			fail("unsupported Fortran-order .npy array in " + path);
+
+		std::size_t count = 1;
+
+		for (std::stringstream dims{std::string(shape)}; !dims.eof();) {
+			std::string dim;
+			std::getline(dims, dim, ',');
+
+			if (dim.find_first_not_of(' ') != dim.npos)
+				count *= std::stoull(dim);
+		}
+
+		const char kind = descr[1];
+		const std::size_t width = descr[2] - '0';
+		const char *const array = data + offset + preamble + header_len;
+
+		if (size - offset - preamble - header_len < count * width)
+			fail("truncated .npy array in " + path);
+
+		value_kind array_kind;
+
+		if (kind == 'f' && width == 4) {
+			convert<float>(array, count, result.data, threads);
+			array_kind = value_kind::float32;
+		} else if (kind == 'f' && width == 8) {
+			convert<double>(array, count, result.data, threads);
+			array_kind = value_kind::float64;
+		} else if (kind == 'i' && width == 4) {
+			convert<std::int32_t>(array, count, result.data, threads);
+			array_kind = value_kind::integer;
+		} else if (kind == 'i' && width == 8) {
+			convert<std::int64_t>(array, count, result.data, threads);
+			array_kind = value_kind::integer;
+		} else {
+			fail("unsupported .npy type '" + std::string(descr) + "' in " + path);
+		}
+
+		// the ULPs of the comparison are those of a single type
+		if (offset > 0 && array_kind != result.kind)
+			fail("the .npy arrays in " + path + " have different types");
+
+		result.kind = array_kind;
+
+		offset += preamble + header_len + count * width;
+	}
+
+	return result;
+}
+
+values read_values(const std::string &path, value_kind text_kind, std::size_t threads) {
+	polybench::mapped_file file(path, error_status);
+
+	const char *data = (const char *)file.data();
+
+	if (file.size() >= 6 && std::memcmp(data, "\x93NUMPY", 6) == 0)
+		return read_npy(data, file.size(), path, threads);
+
+	return read_text(data, file.size(), text_kind, threads);
+}
+
+// the distance of the values in the units in the last place of the given type
+double ulp_distance(double a, double b, value_kind kind) {
+	const auto ordered = [](auto value) {
+		using int_t = std::conditional_t<sizeof(value) == 4, std::int32_t, std::int64_t>;
+
+		// maps the floating-point values onto integers in the same order
+		const auto bits = std::bit_cast<int_t>(value);
+		return bits < 0 ? std::numeric_limits<int_t>::min() - bits : bits;
+	};
+
+	switch (kind) {
+	case value_kind::float32: {
+		const std::int64_t x = ordered((float)a), y = ordered((float)b);
+		return (double)(x > y ? x - y : y - x);
+	}
+	case value_kind::float64: {
+		const std::int64_t x = ordered(a), y = ordered(b);
+
+		// the difference may overflow for values of opposite signs
+		return x > y ? (double)(std::uint64_t)(x - (std::uint64_t)y) : (double)(std::uint64_t)(y - (std::uint64_t)x);
+	}
+	default:
+		return std::abs(a - b);
+	}
+}
+
+errors compare(const values &reference, const values &actual, const tolerance &tol, std::size_t threads) {
+	const std::size_t n = std::min(reference.data.size(), actual.data.size());
+
+	const value_kind kind = reference.kind;
+
+	threads = std::min(threads, n / min_chunk + 1);
+
+	std::vector<errors> parts(threads);
+
+	parallel_for(threads, n, [&](std::size_t begin, std::size_t end, std::size_t t) {
+		errors &part = parts[t];
+
+		part.count = end - begin;
+
+		for (std::size_t i = begin; i < end; ++i) {
+			const double r = reference.data[i];
+			const double a = actual.data[i];
+
+			if (std::isfinite(r))
+				part.reference_squares += r * r;
+
+			if (r == a || (std::isnan(r) && std::isnan(a)))
+				continue;
+
+			const double abs = std::abs(a - r);
+			const double rel = abs / std::abs(r);
+			const double ulp = ulp_distance(r, a, kind);
+
+			if (abs > part.max_abs || std::isnan(abs)) {
+				part.max_abs = abs;
+				part.max_abs_index = i;
+			}
+
+			part.max_rel = std::max(part.max_rel, rel);
+			part.max_ulp = std::max(part.max_ulp, ulp);
+			if (std::isfinite(abs))
+				part.diff_squares += abs * abs;
+
+			if (ulp <= tol.ulp || rel <= tol.rel || abs <= tol.abs)
+				continue;
+
+			if (part.mismatches++ < reported_mismatches)
+				part.first.push_back(i);
+		}
+	});
+
+	errors result;
+
+	for (const auto &part : parts)
+		result.merge(part);
+
+	return result;
+}
+
+// reads the tolerance of the kernel from the file; lines are `kernel [ULP=n] [REL=x] [ABS=x]`, `#` starts a comment
+void read_tolerances(const std::string &path, const std::string &kernel, tolerance &tol) {
+	std::ifstream file(path);
+
+	if (!file)
+		fail("cannot open " + path);
+
+	for (std::string line; std::getline(file, line);) {
+		std::stringstream words(line.substr(0, line.find('#')));
+		std::string name;
+
+		if (!(words >> name) || name != kernel)
+			continue;
+
+		for (std::string word; words >> word;) {
+			const auto eq = word.find('=');
+			const std::string key = word.substr(0, eq);
+			const double value = eq == word.npos ? NAN : std::strtod(word.c_str() + eq + 1, nullptr);
+
+			if (key == "ULP")
+				tol.ulp = value;
+			else if (key == "REL")
+				tol.rel = value;
+			else if (key == "ABS")
+				tol.abs = value;
+			else
+				fail("unknown tolerance '" + word + "' in " + path);
+		}
+	}
+}
+
+void usage(const char *program) {
+	std::cerr << "usage: " << program << " [NAME=value]... REFERENCE ACTUAL" << std::endl;
+	std::cerr << std::endl;
+	std::cerr << "Compares the results of a kernel (text output or .npy arrays) with a reference;" << std::endl;
+	std::cerr << "exits with 1 if they differ beyond the tolerance, with 2 on errors." << std::endl;
+	std::cerr << std::endl;
+	std::cerr << "parameters:" << std::endl;
+	std::cerr << "  ULP=n         accepted distance in units in the last place" << std::endl;
+	std::cerr << "  REL=x         accepted relative difference" << std::endl;
+	std::cerr << "  ABS=x         accepted absolute difference" << std::endl;
+	std::cerr << "  TOLERANCES=f  file with the tolerances of the kernels (overridden by the above)" << std::endl;
+	std::cerr << "  KERNEL=name   the kernel whose tolerances apply" << std::endl;
+	std::cerr << "  TYPE=t        the type of the values in text outputs: float, double (default), or integer" << std::endl;
+	std::cerr << "  THREADS=n     number of threads (default: all hardware threads)" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+	polybench::params params(argc, argv);
+
+	std::vector<std::string> files;
+
+	for (int i = 1; i < argc; ++i)
+		if (std::strchr(argv[i], '=') == nullptr)
+			files.emplace_back(argv[i]);
+
+	if (files.size() != 2) {
+		usage(argv[0]);
+		return error_status;
+	}
+
+	tolerance tol;
+
+	if (auto path = params.get<std::string>("TOLERANCES", ""); !path.empty())
+		read_tolerances(path, params.get<std::string>("KERNEL", ""), tol);
+
+	tol.ulp = params.get("ULP", tol.ulp);
+	tol.rel = params.get("REL", tol.rel);
+	tol.abs = params.get("ABS", tol.abs);
+
+	const auto type = params.get<std::string>("TYPE", "double");
+
+	if (type != "float" && type != "double" && type != "integer")
+		fail("invalid value of TYPE: '" + type + "'");
+
+	const value_kind text_kind = type == "float" ? value_kind::float32 : type == "double" ? value_kind::float64 : value_kind::integer;
+	const std::size_t threads = std::max<std::size_t>(1, params.get<std::size_t>("THREADS", std::thread::hardware_concurrency()));
+
+	values reference, actual;
+
+	{
+		std::thread reader([&] { reference = read_values(files[0], text_kind, threads); });
+		actual = read_values(files[1], text_kind, threads);
+		reader.join();
+	}
+
+	if (reference.kind != actual.kind)
+		fail("the results have different types (" + files[0] + ", " + files[1] + ")");
+
+	const errors result = compare(reference, actual, tol, threads);
+
+	std::cout << "compared " << result.count << " values: " << result.mismatches << " differ" << std::endl;
+
+	if (result.max_abs != 0) {
+		std::cout << "max abs diff " << result.max_abs << " (at " << result.max_abs_index << ")"
+			<< ", max rel diff " << result.max_rel
+			<< ", max ulp diff " << result.max_ulp
+			<< ", rel L2 diff ";
+
+		if (result.reference_squares > 0)
+			std::cout << std::sqrt(result.diff_squares) / std::sqrt(result.reference_squares) << std::endl;
+		else
+			std::cout << "n/a" << std::endl;
+	}
+
+	auto first = result.first;
+	std::sort(first.begin(), first.end());
+	first.resize(std::min(first.size(), reported_mismatches));
+
+	std::cout << std::setprecision(std::numeric_limits<double>::max_digits10);
+
+	for (std::size_t i : first) {
+		std::cout << "reference " << i << " " << reference.data[i] << std::endl;
+		std::cout << "   actual " << i << " " << actual.data[i] << std::endl;
+	}
+
+	if (reference.data.size() != actual.data.size()) {
+		std::cout << "different number of values: " << reference.data.size() << " vs " << actual.data.size() << std::endl;
+		return 1;
+	}
+
+	return result.mismatches ? 1 : 0;
+}
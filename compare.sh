@@ -5,15 +5,50 @@ set -eo pipefail
 # This script compares the output of the C and C++/Noarr implementations of the Polybench benchmarks
 # It assumes that the C++/Noarr implementations are built in the build directory and that the C implementations are built in the $POLYBENCH_C_DIR/build directory
 
+#
+# The outputs are compared by the polybench-compare tool with the accepted differences of each kernel listed in comparator/tolerances.txt;
+# TOLERANCE overrides them with an accepted relative difference for all kernels
+#
+# With RESULT_FORMAT=npy, it compares the binary results of the C++/Noarr implementations with $REFERENCE_DIR/<kernel>.<dataset>.<type>.<result>.<dims>.npy
+# instead, one file per result (a missing reference is created from the current build)
+#
+# With RESULT_FORMAT=checksum, the kernels validate the checksums of their results against $REFERENCE_DIR/<kernel>.<dataset>.<type>.checksum
+# themselves (see include/results.hpp), which is much faster for large datasets; TOLERANCE is the accepted relative error (default 0)
+
 export BUILD_DIR=${BUILD_DIR:-build}
 export SKIP_DIFF=${SKIP_DIFF:-0}
 export ALGORITHM=${ALGORITHM:-}
+export RESULT_FORMAT=${RESULT_FORMAT:-text}
+export REFERENCE_DIR=${REFERENCE_DIR:-}
+export TOLERANCE=${TOLERANCE:-}
+export DATASET_SIZE=${DATASET_SIZE:-EXTRALARGE}
+export DATA_TYPE=${DATA_TYPE:-FLOAT}
+
+if [ "$RESULT_FORMAT" = "npy" ] || [ "$RESULT_FORMAT" = "checksum" ]; then
+	if [ -z "$REFERENCE_DIR" ]; then
+		echo "REFERENCE_DIR is not set" >&2
+		exit 1
+	fi
 
-if [ -z "$POLYBENCH_C_DIR" ]; then
+	mkdir -p "$REFERENCE_DIR"
+elif [ -z "$POLYBENCH_C_DIR" ]; then
 	echo "POLYBENCH_C_DIR is not set" >&2
 	exit 1
 fi
 
+# the type of the values in the text outputs (the ULPs of the comparison are those of the type)
+case "$DATA_TYPE" in
+	FLOAT)
+		compare_type=float
+		;;
+	DOUBLE)
+		compare_type=double
+		;;
+	*)
+		compare_type=integer
+		;;
+esac
+
 dirname=$(mktemp -d)
 
 cleanup() {
@@ -23,13 +58,20 @@ cleanup() {
 
 trap cleanup EXIT
 
-( cd "$POLYBENCH_C_DIR" && ./build.sh )
+if [ "$RESULT_FORMAT" = "text" ]; then
+	( cd "$POLYBENCH_C_DIR" && ./build.sh )
+fi
+
 ( cd . && ./build.sh )
 
 find "$BUILD_DIR" -maxdepth 1 -executable -type f |
 while read -r file; do
 	filename=$(basename "$file")
 
+	# the multi-kernel driver and the comparator are not kernels
+	[ "$filename" = "polybench-noarr" ] && continue
+	[ "$filename" = "polybench-compare" ] && continue
+
 	if [ -n "$ALGORITHM" ]; then
 		case "$filename" in
 			"$ALGORITHM")
@@ -42,6 +84,67 @@ while read -r file; do
 
 	echo "Comparing $filename"
 
+	compare_params=(KERNEL="$filename" TOLERANCES=comparator/tolerances.txt TYPE="$compare_type")
+
+	if [ -n "$TOLERANCE" ]; then
+		compare_params+=(REL="$TOLERANCE")
+	fi
+
+	if [ "$RESULT_FORMAT" = "checksum" ]; then
+		reference="$REFERENCE_DIR/$filename.$DATASET_SIZE.$DATA_TYPE.checksum"
+
+		printf "\tNoarr:             "
+
+		if [ ! -f "$reference" ] || [ "$SKIP_DIFF" -eq 1 ]; then
+			POLYBENCH_RESULT_FORMAT=checksum POLYBENCH_RESULT_FILE="$dirname/cpp.checksum" "$BUILD_DIR/$filename" 2>&1 1>/dev/null
+
+			if [ ! -f "$reference" ]; then
+				echo "creating $reference" >&2
+				cp "$dirname/cpp.checksum" "$reference"
+			fi
+
+			continue
+		fi
+
+		if ! POLYBENCH_RESULT_FORMAT=checksum POLYBENCH_RESULT_FILE="$dirname/cpp.checksum" \
+			POLYBENCH_REFERENCE="$reference" POLYBENCH_TOLERANCE="${TOLERANCE:-0}" "$BUILD_DIR/$filename" 2>&1 1>/dev/null; then
+			echo "Different output on $filename" >&2
+			exit 1
+		fi
+
+		continue
+	fi
+
+	if [ "$RESULT_FORMAT" = "npy" ]; then
+		printf "\tNoarr:             "
+		rm -f "$dirname"/cpp.*.npy
+		POLYBENCH_RESULT_FORMAT=npy POLYBENCH_RESULT_FILE="$dirname/cpp" "$BUILD_DIR/$filename" 2>&1 1>/dev/null
+
+		# one file per result, e.g. cpp.C.ij.npy -> $REFERENCE_DIR/gemm.EXTRALARGE.FLOAT.C.ij.npy
+		for result in "$dirname"/cpp.*.npy; do
+			[ -f "$result" ] || continue
+
+			reference="$REFERENCE_DIR/$filename.$DATASET_SIZE.$DATA_TYPE.${result#"$dirname/cpp."}"
+
+			if [ ! -f "$reference" ]; then
+				echo "creating $reference" >&2
+				cp "$result" "$reference"
+				continue
+			fi
+
+			if [ "$SKIP_DIFF" -eq 1 ] || cmp -s "$reference" "$result"; then
+				continue
+			fi
+
+			if ! "$BUILD_DIR/polybench-compare" "${compare_params[@]}" "$reference" "$result" 1>&2; then
+				echo "Different output on $filename (${result#"$dirname/cpp."})" >&2
+				exit 1
+			fi
+		done
+
+		continue
+	fi
+
 	printf "\tNoarr:             "
 	"$BUILD_DIR/$filename" 2>&1 1> "$dirname/cpp"
 
@@ -52,41 +155,8 @@ while read -r file; do
 		continue
 	fi
 
-	grep -woE '[0-9\.]+|nan' "$dirname/c" > "$dirname/c.tmp" && mv "$dirname/c.tmp" "$dirname/c"
-	grep -woE '[0-9\.]+|nan' "$dirname/cpp" > "$dirname/cpp.tmp" && mv "$dirname/cpp.tmp" "$dirname/cpp"
-
-	# skip files that are exactly the same
-	if cmp -s "$dirname/c" "$dirname/cpp"; then
-		continue
+	if ! "$BUILD_DIR/polybench-compare" "${compare_params[@]}" "$dirname/c" "$dirname/cpp" 1>&2; then
+		echo "Different output on $filename" >&2
+		exit 1
 	fi
-
-	paste "$dirname/c" "$dirname/cpp" |
-	awk "BEGIN {
-		different = 0
-		n = 0
-		changes = 0
-	}
-
-	{
-		n++
-		if (\$1 != \$2 && changes < 10) {
-			print \"baseline\", n, \$1
-			print \"   noarr\", n, \$2
-			changes++
-			different = 1
-		}
-
-		if (changes >= 10)
-			nextfile
-		next
-	}
-
-	{ different = 1; nextfile }
-
-	END {
-		if (different) {
-			printf \"Different output on %s \n\", \"$filename\"
-			exit 1
-		}
-	}" 1>&2
 done
@@ -1,10 +1,21 @@
-#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <optional>
+#include <string>
 
 #include <noarr/traversers.hpp>
 
 #include "defines.hpp"
+#include "params.hpp"
+#include "harness.hpp"
+#include "affinity.hpp"
+#include "memory.hpp"
+#include "results.hpp"
+#include "triangle.hpp"
+#include "mapped_file.hpp"
 #include "covariance.hpp"
 
 using num_t = DATA_TYPE;
@@ -16,10 +27,32 @@ constexpr auto j_vec = noarr::vector<'j'>();
 constexpr auto k_vec = noarr::vector<'k'>();
 
 struct tuning {
+#ifdef TUNING_HEADER
+# include TUNING_HEADER
+#else
 	DEFINE_PROTO_STRUCT(data_layout, j_vec ^ k_vec);
 	DEFINE_PROTO_STRUCT(cov_layout, j_vec ^ i_vec);
+
+	// kernel_covariance_parallel: column strips and upper-triangle tiles of block_size, distributed among threads
+	AUTO_FIELD(parallel, false);
+	AUTO_FIELD(block_size, (std::size_t)64);
+
+	// kernel_covariance_streaming: rows of the input file per chunk
+	AUTO_FIELD(chunk_size, (std::size_t)1024);
+#endif
 } tuning;
 
+// the observations of init_array from the k0-th one on (also a chunk of them for DUMP_INPUT)
+void init_rows(auto data, std::size_t k0, std::size_t rows) {
+	// data: k x j
+	using namespace noarr;
+
+	traverser(data) ^ span<'k'>(0, rows) | [=](auto state) {
+		auto [k, j] = get_indices<'k', 'j'>(state);
+		data[state] = (num_t)((k0 + k) * j) / (data | get_length<'j'>());
+	};
+}
+
 // initialization function
 void init_array(num_t &float_n, auto data) {
 	// data: k x j
@@ -27,10 +60,7 @@ void init_array(num_t &float_n, auto data) {
 
 	float_n = data | get_length<'k'>();
 
-	traverser(data) | [=](auto state) {
-		auto [k, j] = get_indices<'k', 'j'>(state);
-		data[state] = (num_t)(k * j) / (data | get_length<'j'>());
-	};
+	init_rows(data, 0, data | get_length<'k'>());
 }
 
 // computation kernel
@@ -76,41 +106,360 @@ void kernel_covariance(num_t float_n, auto data, auto cov, auto mean) {
 	#pragma endscop
 }
 
+// multi-threaded computation kernel
+//
+// The means are reduced over strips of block_size columns, one column per SIMD
+// lane, and the upper triangle of cov is computed as a blocked SYRK in tiles of
+// block_size x block_size. Every element sums its terms in the same order as
+// in kernel_covariance.
+[[gnu::flatten, gnu::noinline]]
+void kernel_covariance_parallel(num_t float_n, auto data, auto cov, auto mean, std::size_t block_size) {
+	// data: k x j
+	// cov: i x j
+	// mean: j
+	using namespace noarr;
+
+	const std::size_t nk = data | get_length<'k'>();
+	const std::size_t nj = data | get_length<'j'>();
+	const std::size_t blocks = (nj + block_size - 1) / block_size;
+	const std::size_t tiles = polybench::triangle_tiles(blocks); // of the upper triangle of cov
+
+	#pragma omp parallel
+	{
+		// column means
+		#pragma omp for schedule(static)
+		for (std::size_t jb = 0; jb < blocks; ++jb) {
+			const std::size_t j0 = jb * block_size, j1 = std::min(j0 + block_size, nj);
+
+			#pragma omp simd
+			for (std::size_t j = j0; j < j1; ++j)
+				mean[idx<'j'>(j)] = 0;
+
+			for (std::size_t k = 0; k < nk; ++k) {
+				#pragma omp simd
+				for (std::size_t j = j0; j < j1; ++j)
+					mean[idx<'j'>(j)] += data[idx<'k'>(k) & idx<'j'>(j)];
+			}
+
+			#pragma omp simd
+			for (std::size_t j = j0; j < j1; ++j)
+				mean[idx<'j'>(j)] /= float_n;
+		}
+
+		// centering
+		#pragma omp for schedule(static)
+		for (std::size_t k = 0; k < nk; ++k) {
+			#pragma omp simd
+			for (std::size_t j = 0; j < nj; ++j)
+				data[idx<'k'>(k) & idx<'j'>(j)] -= mean[idx<'j'>(j)];
+		}
+
+		// the upper triangle, mirrored to the lower one
+		#pragma omp for schedule(dynamic)
+		for (std::size_t t = 0; t < tiles; ++t) {
+			// the tiles (ib, jb) with ib <= jb
+			const auto [row, col] = polybench::lower_triangle_tile(t);
+			const std::size_t ib = col, jb = row;
+
+			const std::size_t i0 = ib * block_size, i1 = std::min(i0 + block_size, nj);
+			const std::size_t j0 = jb * block_size, j1 = std::min(j0 + block_size, nj);
+
+			for (std::size_t i = i0; i < i1; ++i)
+				for (std::size_t j = std::max(j0, i); j < j1; ++j)
+					cov[idx<'i'>(i) & idx<'j'>(j)] = 0;
+
+			for (std::size_t k = 0; k < nk; ++k) {
+				for (std::size_t i = i0; i < i1; ++i) {
+					const num_t data_ki = data[idx<'k'>(k) & idx<'j'>(i)];
+
+					#pragma omp simd
+					for (std::size_t j = std::max(j0, i); j < j1; ++j)
+						cov[idx<'i'>(i) & idx<'j'>(j)] += data[idx<'k'>(k) & idx<'j'>(j)] * data_ki;
+				}
+			}
+
+			for (std::size_t i = i0; i < i1; ++i) {
+				for (std::size_t j = std::max(j0, i); j < j1; ++j) {
+					cov[idx<'i'>(i) & idx<'j'>(j)] /= float_n - (num_t)1;
+					cov[idx<'i'>(j) & idx<'j'>(i)] = cov[idx<'i'>(i) & idx<'j'>(j)];
+				}
+			}
+		}
+	}
+}
+
+// streaming multi-threaded computation kernel
+//
+// Reads the observations (nk rows of nj values) from the mapped input file in
+// chunks of chunk_size rows and merges the mean and the co-moment matrix of
+// each chunk into the running ones (the pairwise update of Chan et al.), so
+// the memory needed besides the chunk is that of cov and mean. The co-moments
+// of a chunk are a blocked SYRK as in kernel_covariance_parallel.
+[[gnu::flatten, gnu::noinline]]
+void kernel_covariance_streaming(const polybench::mapped_file &input, auto cov, auto mean,
+	auto chunk, auto chunk_mean, auto delta, std::size_t block_size) {
+	// cov: i x j
+	// mean: j
+	// chunk: k x j (the centered rows of the current chunk)
+	// chunk_mean: j (the mean of the current chunk)
+	// delta: j (its difference from the running mean)
+	using namespace noarr;
+
+	const std::size_t nj = mean | get_length<'j'>();
+	const std::size_t chunk_size = chunk | get_length<'k'>();
+	const std::size_t nk = input.size() / (nj * sizeof(num_t));
+	const std::size_t blocks = (nj + block_size - 1) / block_size;
+	const std::size_t tiles = polybench::triangle_tiles(blocks); // of the upper triangle of cov
+
+	// the number of observations minus one, rounded once (nk itself may not be exact in num_t)
+	const num_t divisor = (num_t)(nk - 1.0);
+
+	// data: k x j (the input file)
+	auto data = make_bag(scalar<num_t>() ^ vector<'j'>(nj) ^ vector<'k'>(nk), input.data()).get_ref();
+
+	#pragma omp parallel
+	{
+		#pragma omp for schedule(static)
+		for (std::size_t i = 0; i < nj; ++i) {
+			mean[idx<'j'>(i)] = 0;
+
+			for (std::size_t j = i; j < nj; ++j)
+				cov[idx<'i'>(i) & idx<'j'>(j)] = 0;
+		}
+
+		for (std::size_t k0 = 0; k0 < nk; k0 += chunk_size) {
+			const std::size_t k1 = std::min(k0 + chunk_size, nk);
+
+			// observations merged so far, in the chunk, and in total (exact even beyond the precision of num_t)
+			const std::size_t n_a = k0, n_b = k1 - k0, n_ab = k1;
+
+			// the weights of the chunk in the running mean and in the merged co-moments
+			const num_t mean_weight = (num_t)((double)n_b / n_ab);
+			const num_t comoment_weight = (num_t)((double)n_a * n_b / n_ab);
+
+			// the mean of the chunk; the running mean
+			#pragma omp for schedule(static)
+			for (std::size_t jb = 0; jb < blocks; ++jb) {
+				const std::size_t j0 = jb * block_size, j1 = std::min(j0 + block_size, nj);
+
+				#pragma omp simd
+				for (std::size_t j = j0; j < j1; ++j)
+					chunk_mean[idx<'j'>(j)] = 0;
+
+				for (std::size_t k = k0; k < k1; ++k) {
+					#pragma omp simd
+					for (std::size_t j = j0; j < j1; ++j)
+						chunk_mean[idx<'j'>(j)] += data[idx<'k'>(k) & idx<'j'>(j)];
+				}
+
+				#pragma omp simd
+				for (std::size_t j = j0; j < j1; ++j) {
+					chunk_mean[idx<'j'>(j)] /= (num_t)n_b;
+					delta[idx<'j'>(j)] = chunk_mean[idx<'j'>(j)] - mean[idx<'j'>(j)];
+					mean[idx<'j'>(j)] += delta[idx<'j'>(j)] * mean_weight;
+				}
+			}
+
+			// centering
+			#pragma omp for schedule(static)
+			for (std::size_t k = k0; k < k1; ++k) {
+				#pragma omp simd
+				for (std::size_t j = 0; j < nj; ++j)
+					chunk[idx<'k'>(k - k0) & idx<'j'>(j)] = data[idx<'k'>(k) & idx<'j'>(j)] - chunk_mean[idx<'j'>(j)];
+			}
+
+			#pragma omp single nowait
+			input.release(k0 * nj * sizeof(num_t), (k1 - k0) * nj * sizeof(num_t));
+
+			// the co-moments of the chunk, merged into the upper triangle
+			#pragma omp for schedule(dynamic)
+			for (std::size_t t = 0; t < tiles; ++t) {
+				// the tiles (ib, jb) with ib <= jb
+				const auto [row, col] = polybench::lower_triangle_tile(t);
+				const std::size_t ib = col, jb = row;
+
+				const std::size_t i0 = ib * block_size, i1 = std::min(i0 + block_size, nj);
+				const std::size_t j0 = jb * block_size, j1 = std::min(j0 + block_size, nj);
+
+				for (std::size_t i = i0; i < i1; ++i) {
+					const num_t delta_i = delta[idx<'j'>(i)] * comoment_weight;
+
+					#pragma omp simd
+					for (std::size_t j = std::max(j0, i); j < j1; ++j)
+						cov[idx<'i'>(i) & idx<'j'>(j)] += delta_i * delta[idx<'j'>(j)];
+				}
+
+				for (std::size_t k = 0; k < k1 - k0; ++k) {
+					for (std::size_t i = i0; i < i1; ++i) {
+						const num_t chunk_ki = chunk[idx<'k'>(k) & idx<'j'>(i)];
+
+						#pragma omp simd
+						for (std::size_t j = std::max(j0, i); j < j1; ++j)
+							cov[idx<'i'>(i) & idx<'j'>(j)] += chunk[idx<'k'>(k) & idx<'j'>(j)] * chunk_ki;
+					}
+				}
+			}
+		}
+
+		#pragma omp for schedule(static)
+		for (std::size_t i = 0; i < nj; ++i) {
+			for (std::size_t j = i; j < nj; ++j) {
+				cov[idx<'i'>(i) & idx<'j'>(j)] /= divisor;
+				cov[idx<'i'>(j) & idx<'j'>(i)] = cov[idx<'i'>(i) & idx<'j'>(j)];
+			}
+		}
+	}
+}
+
+// writes the observations of init_array as the input file of kernel_covariance_streaming (nk rows of nj values),
+// generating them a chunk at a time, so that the file may be larger than the memory
+void write_input(const std::string &path, std::size_t nk, auto chunk) {
+	// chunk: k x j
+	using namespace noarr;
+
+	const std::size_t chunk_size = chunk | get_length<'k'>();
+
+	std::ofstream file(path, std::ios::binary);
+
+	for (std::size_t k0 = 0; k0 < nk; k0 += chunk_size) {
+		const std::size_t rows = std::min(chunk_size, nk - k0);
+
+		init_rows(chunk, k0, rows);
+
+		traverser(chunk) ^ span<'k'>(0, rows) ^ hoist<'k'>() | [&](auto state) {
+			const num_t value = chunk[state];
+			file.write((const char *)&value, sizeof(value));
+		};
+	}
+
+	if (!file) {
+		std::cerr << "cannot write " << path << std::endl;
+		std::exit(EXIT_FAILURE);
+	}
+}
+
+// floating-point operations of kernel_covariance
+constexpr double flop_count(std::size_t nk, std::size_t nj) {
+	return nj * nk * (nj + 1.0) + 2.0 * nj * nk;
+}
+
+// compulsory memory traffic of kernel_covariance in bytes (inputs read and outputs written once)
+constexpr double byte_count(std::size_t nk, std::size_t nj) {
+	return sizeof(num_t) * (2.0 * nk * nj + 1.0 * nj * nj + nj);
+}
+
 } // namespace
 
-int main(int argc, char *argv[]) {
+int KERNEL_MAIN(int argc, char *argv[]) {
 	using namespace std::string_literals;
 
+	// benchmark parameters
+	polybench::params params(argc, argv);
+
+	// the sizes of the selected variant
+	if (tuning.parallel) {
+		polybench::require_tuning_size("block_size", tuning.block_size);
+	}
+
 	// problem size
-	std::size_t nk = NK;
-	std::size_t nj = NJ;
+	std::size_t nk = params.size("NK", NK);
+	std::size_t nj = params.size("NJ", NJ);
+
+	// streaming mode: the observations are read from this file (written by DUMP_INPUT=path)
+	std::string input_path = params.get<std::string>("INPUT", "");
+	std::string dump_path = params.get<std::string>("DUMP_INPUT", "");
+	std::optional<polybench::mapped_file> input;
+
+	if (!input_path.empty()) {
+		input.emplace(input_path);
+
+		if (nj == 0 || input->size() % (nj * sizeof(num_t)) != 0) {
+			std::cerr << input_path << " does not hold rows of " << nj << " values" << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		nk = input->size() / (nj * sizeof(num_t));
+
+		// the sizes of the streaming variant
+		polybench::require_tuning_size("block_size", tuning.block_size);
+	}
+
+	// the observations pass through chunks of chunk_size rows in the streaming mode and in DUMP_INPUT
+	const bool streamed = input || !dump_path.empty();
+
+	if (streamed)
+		polybench::require_tuning_size("chunk_size", tuning.chunk_size);
 
 	auto set_lengths = noarr::set_length<'k'>(nk) ^ noarr::set_length<'j'>(nj) ^ noarr::set_length<'i'>(nj);
 
-	// data
+	polybench::affinity affinity(params);
+	polybench::memory memory(params);
+
+	// data (not allocated in the streaming mode and in DUMP_INPUT, which only allocate the chunk and its means),
+	// partitioned as by the parallel variants: the centered rows, the rows of tiles of cov, the column strips
 	num_t float_n;
-	auto data = noarr::make_bag(noarr::scalar<num_t>() ^ tuning.data_layout ^ set_lengths);
-	auto cov = noarr::make_bag(noarr::scalar<num_t>() ^ tuning.cov_layout ^ set_lengths);
-	auto mean = noarr::make_bag(noarr::scalar<num_t>() ^ noarr::vector<'j'>(nj));
+	auto data = memory.make_bag(noarr::scalar<num_t>() ^ tuning.data_layout ^ noarr::set_length<'k'>(streamed ? 0 : nk) ^ noarr::set_length<'j'>(nj),
+		polybench::partition<'k'>{});
+	auto cov = memory.make_bag(noarr::scalar<num_t>() ^ tuning.cov_layout ^ set_lengths, polybench::partition<'i'>{tuning.block_size});
+	auto mean = memory.make_bag(noarr::scalar<num_t>() ^ noarr::vector<'j'>(nj), polybench::partition<'j'>{tuning.block_size});
 
-	// initialize data
-	init_array(float_n, data.get_ref());
+	auto chunk = memory.make_bag(noarr::scalar<num_t>() ^ noarr::vector<'j'>(nj) ^ noarr::vector<'k'>(streamed ? tuning.chunk_size : 0),
+		polybench::partition<'k'>{});
+	auto chunk_mean = memory.make_bag(noarr::scalar<num_t>() ^ noarr::vector<'j'>(input ? nj : 0));
+	auto delta = memory.make_bag(noarr::scalar<num_t>() ^ noarr::vector<'j'>(input ? nj : 0));
 
-	auto start = std::chrono::high_resolution_clock::now();
+	if (!dump_path.empty()) {
+		write_input(dump_path, nk, chunk.get_ref());
+		return 0;
+	}
 
-	// run kernel
-	kernel_covariance(float_n, data.get_ref(), cov.get_ref(), mean.get_ref());
+	polybench::harness harness("covariance", params);
 
-	auto end = std::chrono::high_resolution_clock::now();
+	harness
+		.length("nk", nk)
+		.length("nj", nj)
+		.tuning("data_layout", tuning.data_layout)
+		.tuning("cov_layout", tuning.cov_layout)
+		.tuning("parallel", tuning.parallel)
+		.tuning("block_size", tuning.block_size)
+		.tuning("chunk_size", tuning.chunk_size)
+		.environment(affinity.settings())
+		.environment(memory.settings())
+		.flops(flop_count(nk, nj))
+		.bytes(byte_count(nk, nj));
 
-	auto duration = std::chrono::duration<long double>(end - start);
+	harness.run([&] {
+		// initialize data
+		if (input)
+			float_n = nk;
+		else
+			init_array(float_n, data.get_ref());
+	}, [&] {
+		// run kernel
+		if (input)
+			kernel_covariance_streaming(*input, cov.get_ref(), mean.get_ref(), chunk.get_ref(), chunk_mean.get_ref(), delta.get_ref(), tuning.block_size);
+		else if (tuning.parallel)
+			kernel_covariance_parallel(float_n, data.get_ref(), cov.get_ref(), mean.get_ref(), tuning.block_size);
+		else
+			kernel_covariance(float_n, data.get_ref(), cov.get_ref(), mean.get_ref());
+	});
 
 	// print results
+	polybench::results results(params);
+
 	if (argc > 0 && argv[0] != ""s) {
-		std::cout << std::fixed << std::setprecision(2);
-		noarr::serialize_data(std::cout, cov.get_ref() ^ noarr::hoist<'i'>());
+		if (results.text()) {
+			std::cout << std::fixed << std::setprecision(2);
+			noarr::serialize_data(std::cout, cov.get_ref() ^ noarr::hoist<'i'>());
+		}
+		else {
+			results.write<'i', 'j'>("cov", cov.get_ref());
+		}
 	}
 
-	std::cerr << std::fixed << std::setprecision(6);
-	std::cerr << duration.count() << std::endl;
+	harness.environment(memory.placement());
+	harness.report(std::cerr);
+	memory.report(std::cerr);
+
+	return 0;
 }
@@ -0,0 +1,103 @@
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <fnmatch.h>
+
+#include "memory.hpp"
+#include "params.hpp"
+
+// entry points of the kernels (see KERNEL_MAIN in defines.hpp)
+#define KERNEL(name, entry) int entry(int argc, char *argv[]);
+#include "kernels.inc"
+#undef KERNEL
+
+namespace {
+
+struct kernel {
+	const char *name;
+	int (*main)(int argc, char *argv[]);
+};
+
+constexpr kernel kernels[] = {
+#define KERNEL(name, entry) {name, entry},
+#include "kernels.inc"
+#undef KERNEL
+};
+
+void usage(const char *program) {
+	std::cerr << "usage: " << program << " [NAME=value]... PATTERN..." << std::endl;
+	std::cerr << std::endl;
+	std::cerr << "Runs the kernels matching the glob PATTERNs in the given order;" << std::endl;
+	std::cerr << "the NAME=value parameters are passed to each of them." << std::endl;
+	std::cerr << "ROUNDS=n repeats the whole sequence n times." << std::endl;
+	std::cerr << "SHARED_BUFFERS=off gives each kernel freshly mapped buffers (see polybench::memory)." << std::endl;
+	std::cerr << std::endl;
+	std::cerr << "kernels:";
+
+	for (const auto &kernel : kernels)
+		std::cerr << " " << kernel.name;
+
+	std::cerr << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+	polybench::params params(argc, argv);
+
+	// the parameters are forwarded to the kernels, the rest of the arguments select them
+	std::vector<char *> args = {nullptr};
+	std::vector<const kernel *> selected;
+
+	for (int i = 1; i < argc; ++i) {
+		if (std::strchr(argv[i], '=') != nullptr) {
+			args.push_back(argv[i]);
+			continue;
+		}
+
+		bool found = false;
+
+		for (const auto &kernel : kernels) {
+			if (fnmatch(argv[i], kernel.name, 0) == 0) {
+				selected.push_back(&kernel);
+				found = true;
+			}
+		}
+
+		if (!found) {
+			std::cerr << "no kernel matches '" << argv[i] << "'" << std::endl;
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (selected.empty()) {
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	args.push_back(nullptr);
+
+	const auto rounds = params.get<std::size_t>("ROUNDS", 1);
+
+	// a kernel reuses the buffers of the preceding ones instead of mapping (and faulting in) its own
+	polybench::memory::share_buffers(params.get("SHARED_BUFFERS", true));
+
+	// structured reports name the kernel on their own
+	const bool prefix = params.get<std::string>("FORMAT", "text") == "text";
+
+	for (std::size_t round = 0; round < rounds; ++round) {
+		for (const auto *kernel : selected) {
+			args.front() = const_cast<char *>(kernel->name);
+
+			if (prefix)
+				std::cerr << kernel->name << ": " << std::flush;
+
+			if (int status = kernel->main(args.size() - 1, args.data()); status != 0)
+				return status;
+		}
+	}
+}
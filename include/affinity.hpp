@@ -0,0 +1,266 @@
+#ifndef NOARR_POLYBENCH_AFFINITY_HPP
+#define NOARR_POLYBENCH_AFFINITY_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+# include <sched.h>
+#endif
+
+#ifdef _OPENMP
+# include <omp.h>
+#endif
+
+#include "params.hpp"
+
+namespace polybench {
+
+// The placement of the threads of a kernel on the cores of the machine
+//
+// Parameters (see polybench::params):
+//   AFFINITY         the order in which the threads are pinned to the allowed CPUs:
+//                      none (default)  no pinning, or pinning in the order of CORES (or without the SMT siblings) if given
+//                      compact         the cores of a package one after another, the SMT siblings of a core next to each other
+//                      scatter         round-robin over the packages, the second siblings of the cores after all the first ones
+//   CORES            the CPUs to pin to, e.g. `0-3,8` (default all the CPUs the process may run on)
+//   SMT              use the SMT siblings of the cores (default on); off pins at most one thread to each core
+//   AFFINITY_REPORT  print the CPU of each thread (default off)
+//
+// The main thread is pinned to the first CPU, the OpenMP thread i to the i-th CPU (wrapping around
+// if there are more threads than CPUs). The affinity object should be created before the data is
+// allocated (polybench::memory), so that the pages are touched by the pinned threads. Pinning starts
+// the OpenMP thread pool; the perf counters of the harness are opened on each of its threads, so
+// they count the pinned threads regardless of the order the objects are created in.
+class affinity {
+public:
+	explicit affinity(const params &params)
+		: policy_(params.get<std::string>("AFFINITY", "none")),
+		  smt_(params.get("SMT", true)),
+		  report_(params.get("AFFINITY_REPORT", false))
+	{
+		if (policy_ != "none" && policy_ != "compact" && policy_ != "scatter") {
+			std::cerr << "invalid value of AFFINITY: '" << policy_ << "'" << std::endl;
+			std::exit(EXIT_FAILURE);
+		}
+
+		const std::string cores = params.get<std::string>("CORES", "");
+
+		if (policy_ == "none" && cores.empty() && smt_)
+			return;
+
+#ifdef __linux__
+		cpus_ = order(allowed_cpus(cores));
+
+		if (cpus_.empty()) {
+			std::cerr << "affinity: no CPUs to pin to" << std::endl;
+			std::exit(EXIT_FAILURE);
+		}
+
+		pin();
+#else
+		std::cerr << "affinity: AFFINITY=" << policy_ << " is not supported on this platform" << std::endl;
+#endif
+	}
+
+	// the placement in effect, for the report of the harness
+	std::vector<std::pair<std::string, std::string>> settings() const {
+		std::string placement;
+
+		for (std::size_t thread = 0; thread < threads_.size(); ++thread)
+			placement += (thread ? "," : "") + std::to_string(threads_[thread]);
+
+		return {
+			{"affinity", cpus_.empty() ? "none" : policy_ == "none" ? "list" : policy_},
+			{"smt", smt_ ? "on" : "off"},
+			{"cpus", cpus_.empty() ? "any" : placement},
+		};
+	}
+
+private:
+	// a logical CPU and its position in the topology of the machine
+	struct cpu {
+		int id;
+		int package;
+		int core;
+		int sibling; // the index among the SMT siblings of its core
+	};
+
+	std::string policy_;
+	bool smt_;
+	bool report_;
+	std::vector<int> cpus_;    // in the order of pinning
+	std::vector<int> threads_; // the CPU of each thread
+
+	// parses a list of CPUs, e.g. "0-3,8"
+	static std::vector<int> parse_list(const std::string &list) {
+		std::vector<int> result;
+
+		for (std::size_t pos = 0; pos < list.size();) {
+			std::size_t end = list.find(',', pos);
+			end = end == std::string::npos ? list.size() : end;
+
+			const std::string range = list.substr(pos, end - pos);
+			const std::size_t dash = range.find('-');
+
+			try {
+				const int first = std::stoi(range.substr(0, dash));
+				const int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+
+				for (int id = first; id <= last; ++id)
+					result.push_back(id);
+			} catch (const std::exception &) {
+				std::cerr << "invalid value of CORES: '" << list << "'" << std::endl;
+				std::exit(EXIT_FAILURE);
+			}
+
+			pos = end + 1;
+		}
+
+		return result;
+	}
+
+	static int read_topology(int id, const char *name, int default_value) {
+		std::ifstream file("/sys/devices/system/cpu/cpu" + std::to_string(id) + "/topology/" + name);
+		int value;
+
+		return file >> value ? value : default_value;
+	}
+
+#ifdef __linux__
+	// the CPUs of the list (or all of them) the process may run on, with their topology, in the order of the list
+	std::vector<cpu> allowed_cpus(const std::string &cores) const {
+		cpu_set_t mask;
+		CPU_ZERO(&mask);
+
+		if (sched_getaffinity(0, sizeof(mask), &mask) != 0) {
+			std::cerr << "affinity: sched_getaffinity failed" << std::endl;
+			std::exit(EXIT_FAILURE);
+		}
+
+		std::vector<int> ids;
+
+		if (cores.empty()) {
+			for (int id = 0; id < CPU_SETSIZE; ++id)
+				if (CPU_ISSET(id, &mask))
+					ids.push_back(id);
+		} else {
+			ids = parse_list(cores);
+
+			for (int id : ids) {
+				if (id < 0 || id >= CPU_SETSIZE || !CPU_ISSET(id, &mask)) {
+					std::cerr << "affinity: CPU " << id << " of CORES is not available to the process" << std::endl;
+					std::exit(EXIT_FAILURE);
+				}
+			}
+		}
+
+		std::vector<cpu> result;
+		std::map<std::pair<int, int>, int> siblings;
+
+		for (int id : ids) {
+			const int package = read_topology(id, "physical_package_id", 0);
+			const int core = read_topology(id, "core_id", id);
+
+			result.push_back({id, package, core, siblings[{package, core}]++});
+		}
+
+		return result;
+	}
+#endif
+
+	// orders the CPUs by the policy and drops the SMT siblings if they are not used
+	std::vector<int> order(std::vector<cpu> cpus) const {
+		if (!smt_)
+			std::erase_if(cpus, [](const cpu &cpu) { return cpu.sibling > 0; });
+
+		// (the SMT siblings of a core are numbered in the order of CORES, i.e., by their ids by default)
+		if (policy_ == "compact") {
+			std::stable_sort(cpus.begin(), cpus.end(), [](const cpu &a, const cpu &b) {
+				return std::tie(a.package, a.core, a.id) < std::tie(b.package, b.core, b.id);
+			});
+		} else if (policy_ == "scatter") {
+			// the rank of each core within its package
+			std::map<std::pair<int, int>, int> ranks;
+			std::map<int, int> counts;
+
+			std::vector<cpu> sorted = cpus;
+			std::sort(sorted.begin(), sorted.end(), [](const cpu &a, const cpu &b) {
+				return std::tie(a.package, a.core) < std::tie(b.package, b.core);
+			});
+
+			for (const auto &cpu : sorted)
+				if (ranks.emplace(std::pair(cpu.package, cpu.core), counts[cpu.package]).second)
+					++counts[cpu.package];
+
+			std::stable_sort(cpus.begin(), cpus.end(), [&ranks](const cpu &a, const cpu &b) {
+				const int rank_a = ranks.at({a.package, a.core});
+				const int rank_b = ranks.at({b.package, b.core});
+
+				return std::tie(a.sibling, rank_a, a.package, a.id) < std::tie(b.sibling, rank_b, b.package, b.id);
+			});
+		}
+
+		std::vector<int> result;
+
+		for (const auto &cpu : cpus)
+			result.push_back(cpu.id);
+
+		return result;
+	}
+
+#ifdef __linux__
+	// pins the calling thread to the given CPU
+	static bool pin_thread(int id) {
+		cpu_set_t mask;
+		CPU_ZERO(&mask);
+		CPU_SET(id, &mask);
+
+		return sched_setaffinity(0, sizeof(mask), &mask) == 0;
+	}
+
+	void pin() {
+		bool failed = false;
+
+#ifdef _OPENMP
+		// the threads of the OpenMP runtime are reused by the parallel regions of the kernel
+		threads_.assign(omp_get_max_threads(), -1);
+
+		#pragma omp parallel reduction(||:failed)
+		{
+			const int thread = omp_get_thread_num();
+			const int id = cpus_[thread % cpus_.size()];
+
+			failed = !pin_thread(id);
+			threads_[thread] = id;
+		}
+#endif
+
+		// the main thread (also the thread 0 of the OpenMP runtime)
+		failed = !pin_thread(cpus_.front()) || failed;
+
+		if (threads_.empty())
+			threads_.push_back(cpus_.front());
+
+		if (failed)
+			std::cerr << "affinity: sched_setaffinity failed, the placement is incomplete" << std::endl;
+
+		if (report_)
+			for (std::size_t thread = 0; thread < threads_.size(); ++thread)
+				std::cerr << "affinity: thread " << thread << " -> cpu " << threads_[thread] << std::endl;
+	}
+#endif
+};
+
+} // namespace polybench
+
+#endif // NOARR_POLYBENCH_AFFINITY_HPP
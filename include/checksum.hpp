@@ -0,0 +1,194 @@
+#ifndef NOARR_POLYBENCH_CHECKSUM_HPP
+#define NOARR_POLYBENCH_CHECKSUM_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace polybench {
+
+// A small summary of a result that can be validated against a reference without the full data
+//
+// Besides the totals, the values are split into (at most max_blocks) contiguous
+// blocks of nearly equal size, each summarized by its sum, the sum of its
+// absolute values and its L2 norm, so that an error confined to a few values
+// (e.g. a wrong tile or row) still changes the summary of their block.
+struct checksum {
+	static constexpr std::size_t max_blocks = 1024;
+
+	std::size_t count = 0;
+	std::uint64_t hash = 0; // FNV-1a of the values in the order they are given
+	double sum = 0;
+	double norm = 0; // L2 norm
+	std::vector<double> block_sums;
+	std::vector<double> block_abs_sums;
+	std::vector<double> block_norms;
+};
+
+// The differences of a result from its reference
+struct checksum_diff {
+	bool identical;
+	double max_block_sum_diff;  // the largest absolute difference of the sum of a block
+	double rel_block_sum_diff;  // the largest difference of the sum of a block, relative to the sum of its absolute values
+	double rel_block_norm_diff; // the largest difference of the norm of a block, relative to its norm
+	double rel_norm_diff;
+	double rel_sum_diff;
+};
+
+// computes the checksum of the values in the order they are given (the summation order is fixed, so the checksum is reproducible)
+template<class T>
+checksum make_checksum(const T *data, std::size_t count) {
+	checksum result;
+
+	result.count = count;
+	result.hash = 0xcbf29ce484222325;
+
+	const auto *bytes = (const unsigned char *)data;
+
+	for (std::size_t i = 0; i < count * sizeof(T); ++i) {
+		result.hash ^= bytes[i];
+		result.hash *= 0x100000001b3;
+	}
+
+	const std::size_t blocks = std::min(count, checksum::max_blocks);
+
+	result.block_sums.reserve(blocks);
+	result.block_abs_sums.reserve(blocks);
+	result.block_norms.reserve(blocks);
+
+	double sum = 0;
+	double squares = 0;
+
+	for (std::size_t b = 0; b < blocks; ++b) {
+		double block_sum = 0;
+		double block_abs_sum = 0;
+		double block_squares = 0;
+
+		for (std::size_t i = b * count / blocks; i < (b + 1) * count / blocks; ++i) {
+			const double value = (double)data[i];
+
+			block_sum += value;
+			block_abs_sum += std::abs(value);
+			block_squares += value * value;
+		}
+
+		result.block_sums.push_back(block_sum);
+		result.block_abs_sums.push_back(block_abs_sum);
+		result.block_norms.push_back(std::sqrt(block_squares));
+
+		sum += block_sum;
+		squares += block_squares;
+	}
+
+	result.sum = sum;
+	result.norm = std::sqrt(squares);
+
+	return result;
+}
+
+// writes the checksum as four lines of text; the floating-point values are exact (hexadecimal)
+inline void write_checksum(std::ostream &out, const checksum &checksum) {
+	char hash[17];
+
+	std::snprintf(hash, sizeof(hash), "%016llx", (unsigned long long)checksum.hash);
+
+	out << "count " << checksum.count << " hash " << hash << std::hexfloat
+		<< " sum " << checksum.sum << " norm " << checksum.norm << " blocks " << checksum.block_sums.size() << '\n';
+
+	for (const auto *values : {&checksum.block_sums, &checksum.block_abs_sums, &checksum.block_norms}) {
+		for (std::size_t b = 0; b < values->size(); ++b)
+			out << (b ? " " : "") << (*values)[b];
+
+		out << '\n';
+	}
+
+	out << std::defaultfloat;
+}
+
+// reads a checksum written by write_checksum; returns false at the end of the input or on malformed input
+inline bool read_checksum(std::istream &in, checksum &checksum) {
+	// std::istream does not parse hexadecimal floating-point numbers
+	const auto number = [&in](double &value) {
+		std::string token;
+
+		if (!(in >> token))
+			return false;
+
+		char *end;
+		value = std::strtod(token.c_str(), &end);
+
+		return *end == '\0';
+	};
+
+	std::string count, hash, sum, norm, blocks, hash_value;
+	std::size_t block_count;
+
+	if (!(in >> count >> checksum.count >> hash >> hash_value) || count != "count" || hash != "hash")
+		return false;
+
+	checksum.hash = std::strtoull(hash_value.c_str(), nullptr, 16);
+
+	if (!(in >> sum) || sum != "sum" || !number(checksum.sum) || !(in >> norm) || norm != "norm" || !number(checksum.norm))
+		return false;
+
+	if (!(in >> blocks >> block_count) || blocks != "blocks")
+		return false;
+
+	for (auto *values : {&checksum.block_sums, &checksum.block_abs_sums, &checksum.block_norms}) {
+		values->resize(block_count);
+
+		for (auto &value : *values)
+			if (!number(value))
+				return false;
+	}
+
+	return true;
+}
+
+// compares the checksums; the relative differences are taken to max(|reference|, floor),
+// so that a reference below the floor (e.g. an all-zero block) is compared in absolute terms
+inline checksum_diff compare_checksums(const checksum &reference, const checksum &actual, double floor) {
+	const auto relative = [floor](double diff, double reference) {
+		return std::abs(diff) / std::max(std::abs(reference), floor);
+	};
+
+	// NaNs must not vanish in std::max
+	const auto max = [](double a, double b) {
+		return b > a || std::isnan(b) ? b : a;
+	};
+
+	checksum_diff diff;
+
+	diff.identical = reference.count == actual.count && reference.hash == actual.hash;
+	diff.max_block_sum_diff = 0;
+	diff.rel_block_sum_diff = 0;
+	diff.rel_block_norm_diff = 0;
+
+	// the blocks only correspond to each other if the counts match
+	if (reference.count == actual.count && reference.block_sums.size() == actual.block_sums.size()) {
+		for (std::size_t b = 0; b < reference.block_sums.size(); ++b) {
+			const double sum_diff = actual.block_sums[b] - reference.block_sums[b];
+
+			diff.max_block_sum_diff = max(diff.max_block_sum_diff, std::abs(sum_diff));
+			diff.rel_block_sum_diff = max(diff.rel_block_sum_diff, relative(sum_diff, reference.block_abs_sums[b]));
+			diff.rel_block_norm_diff = max(diff.rel_block_norm_diff,
+				relative(actual.block_norms[b] - reference.block_norms[b], reference.block_norms[b]));
+		}
+	}
+
+	diff.rel_norm_diff = relative(actual.norm - reference.norm, reference.norm);
+	diff.rel_sum_diff = relative(actual.sum - reference.sum, reference.sum);
+
+	return diff;
+}
+
+} // namespace polybench
+
+#endif // NOARR_POLYBENCH_CHECKSUM_HPP
@@ -9,6 +9,13 @@
 #define DEFINE_PROTO_STRUCT(name, ...) AUTO_FIELD(name, __VA_ARGS__); \
     static_assert(noarr::IsProtoStruct<decltype(name)>)
 
+// the polybench-noarr driver links all kernels into one binary, each under its own entry point
+#ifdef KERNEL_ENTRY
+# define KERNEL_MAIN KERNEL_ENTRY
+#else
+# define KERNEL_MAIN main
+#endif
+
 #if !defined(MINI_DATASET) && !defined(SMALL_DATASET) && !defined(MEDIUM_DATASET) && !defined(LARGE_DATASET) && !defined(EXTRALARGE_DATASET)
 # error "Please define one of MINI_DATASET, SMALL_DATASET, MEDIUM_DATASET, LARGE_DATASET, EXTRALARGE_DATASET"
 # define MINI_DATASET
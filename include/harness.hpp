@@ -0,0 +1,206 @@
+#ifndef NOARR_POLYBENCH_HARNESS_HPP
+#define NOARR_POLYBENCH_HARNESS_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "params.hpp"
+#include "perf_counters.hpp"
+#include "report.hpp"
+#include "roofline.hpp"
+#include "statistics.hpp"
+
+namespace polybench {
+
+// terminates the program if a size of the tuning structure of a kernel is zero
+// (the tuning headers of TUNING_DIR and autotune.sh may set any value)
+inline void require_tuning_size(std::string_view name, std::size_t value) {
+	if (value == 0) {
+		std::cerr << "invalid tuning: " << name << " must be positive" << std::endl;
+		std::exit(EXIT_FAILURE);
+	}
+}
+
+// Measures a kernel repeatedly within a single process
+//
+// Parameters (see polybench::params):
+//   RUNS        number of measured runs (default 1)
+//   WARMUP      number of unmeasured runs preceding them (default 0)
+//   COLD_CACHE  evict the caches before each run (default off)
+//   FLUSH_SIZE  size of the buffer that evicts the caches, in bytes (default 64 MiB)
+//   FORMAT      format of the report: text (default), json (one line per kernel), or csv (one row per run)
+//   CSV_HEADER  precede the csv report with a header row (default on)
+//   OUTPUT      append the report to the given file instead of the standard error output
+//   PERF_COUNTERS  measure hardware performance counters of each run (default off, Linux only)
+//   PEAK_GFLOPS    peak floating-point performance of the machine, for the roofline report
+//   STREAM_BANDWIDTH  memory bandwidth of the machine in GB/s, or `measure` to run a STREAM triad
+//   STREAM_SIZE    total size of the STREAM triad arrays, in bytes (default 384 MiB)
+//
+// The inputs are re-initialized before every run, so each run computes the same result.
+class harness {
+public:
+	harness(std::string kernel, const params &params)
+		: runs_(params.get<std::size_t>("RUNS", 1)),
+		  warmup_(params.get<std::size_t>("WARMUP", 0)),
+		  cold_cache_(params.get("COLD_CACHE", false)),
+		  flush_size_(params.get<std::size_t>("FLUSH_SIZE", 64 << 20)),
+		  format_(params.get<std::string>("FORMAT", "text")),
+		  csv_header_(params.get("CSV_HEADER", true)),
+		  output_(params.get<std::string>("OUTPUT", "")),
+		  counters_(params.get("PERF_COUNTERS", false))
+	{
+		if (runs_ == 0)
+			runs_ = 1;
+
+		if (format_ != "text" && format_ != "json" && format_ != "csv") {
+			std::cerr << "invalid value of FORMAT: '" << format_ << "'" << std::endl;
+			std::exit(EXIT_FAILURE);
+		}
+
+		record_.kernel = std::move(kernel);
+
+		// the counters are summed over the threads of the OpenMP pool (pinned by polybench::affinity if requested)
+		if (counters_.enabled())
+			record_.environment.emplace_back("counter_threads", std::to_string(counters_.threads()));
+		record_.peak_gflops = params.get("PEAK_GFLOPS", 0.0);
+
+		if (params.get<std::string>("STREAM_BANDWIDTH", "") == "measure")
+			record_.stream_bandwidth = measure_stream_bandwidth(params.get<std::size_t>("STREAM_SIZE", 384 << 20));
+		else
+			record_.stream_bandwidth = params.get("STREAM_BANDWIDTH", 0.0);
+	}
+
+	// records a problem size of the kernel
+	harness &length(std::string name, std::size_t value) {
+		record_.lengths.emplace_back(std::move(name), value);
+		return *this;
+	}
+
+	// records a field of the tuning structure of the kernel (a proto-structure or a plain value)
+	template<class Field>
+	harness &tuning(std::string name, const Field &field) {
+		if constexpr (std::is_same_v<Field, bool>)
+			record_.tuning.emplace_back(std::move(name), field ? "true" : "false");
+		else if constexpr (std::is_arithmetic_v<Field>)
+			record_.tuning.emplace_back(std::move(name), std::to_string(field));
+		else
+			record_.tuning.emplace_back(std::move(name), type_name(field));
+
+		return *this;
+	}
+
+	// records settings of the environment of the kernel (e.g. polybench::memory::settings)
+	harness &environment(const std::vector<std::pair<std::string, std::string>> &settings) {
+		record_.environment.insert(record_.environment.end(), settings.begin(), settings.end());
+		return *this;
+	}
+
+	// records the floating-point operations of a single run
+	harness &flops(double flops) {
+		record_.flops = flops;
+		return *this;
+	}
+
+	// records the compulsory memory traffic of a single run, in bytes
+	harness &bytes(double bytes) {
+		record_.bytes = bytes;
+		return *this;
+	}
+
+	void run(auto &&init, auto &&kernel) {
+		record_.times.clear();
+		record_.counters.clear();
+
+		for (std::size_t run = 0; run < warmup_ + runs_; ++run) {
+			init();
+
+			if (cold_cache_)
+				flush_caches();
+
+			if (counters_.enabled())
+				counters_.start();
+
+			auto start = std::chrono::high_resolution_clock::now();
+
+			kernel();
+
+			auto end = std::chrono::high_resolution_clock::now();
+
+			if (counters_.enabled()) {
+				auto counters = counters_.stop();
+
+				if (run >= warmup_)
+					record_.counters.push_back(counters);
+			}
+
+			if (run >= warmup_)
+				record_.times.push_back(std::chrono::duration<double>(end - start).count());
+		}
+	}
+
+	const record &result() const { return record_; }
+
+	statistics stats() const { return statistics::of(record_.times); }
+
+	// writes the report in the selected format to `out` (or to OUTPUT if given)
+	void report(std::ostream &out) const {
+		if (!output_.empty()) {
+			std::ofstream file(output_, std::ios::app);
+
+			if (!file) {
+				std::cerr << "cannot open " << output_ << std::endl;
+				std::exit(EXIT_FAILURE);
+			}
+
+			write(file);
+		} else {
+			write(out);
+		}
+	}
+
+private:
+	std::size_t runs_;
+	std::size_t warmup_;
+	bool cold_cache_;
+	std::size_t flush_size_;
+	std::string format_;
+	bool csv_header_;
+	std::string output_;
+	perf_counters counters_;
+
+	record record_;
+	std::vector<unsigned char> flush_buffer_;
+
+	void write(std::ostream &out) const {
+		if (format_ == "json")
+			write_json(out, record_);
+		else if (format_ == "csv")
+			write_csv(out, record_, csv_header_);
+		else
+			write_text(out, record_);
+	}
+
+	// touches a buffer larger than the last-level cache
+	void flush_caches() {
+		flush_buffer_.resize(flush_size_);
+
+		for (auto &byte : flush_buffer_)
+			++byte;
+
+		volatile unsigned char sink = std::accumulate(flush_buffer_.begin(), flush_buffer_.end(), (unsigned char)0);
+		(void)sink;
+	}
+};
+
+} // namespace polybench
+
+#endif // NOARR_POLYBENCH_HARNESS_HPP
@@ -0,0 +1,94 @@
+#ifndef NOARR_POLYBENCH_MAPPED_FILE_HPP
+#define NOARR_POLYBENCH_MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#if defined(__unix__) || defined(__APPLE__)
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
+
+namespace polybench {
+
+// A read-only memory mapping of a whole file, meant to be read sequentially
+//
+// Failures to open or map the file are fatal (the benchmark cannot run without its input);
+// they exit with the given status.
+class mapped_file {
+public:
+	explicit mapped_file(const std::string &path, int failure_status = EXIT_FAILURE) {
+#if defined(__unix__) || defined(__APPLE__)
+		const int fd = open(path.c_str(), O_RDONLY);
+
+		if (fd == -1)
+			fail("cannot open", path, failure_status);
+
+		struct stat st;
+
+		if (fstat(fd, &st) != 0)
+			fail("cannot stat", path, failure_status);
+
+		size_ = st.st_size;
+
+		if (size_ > 0) {
+			data_ = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+
+			if (data_ == MAP_FAILED)
+				fail("cannot map", path, failure_status);
+
+			madvise(data_, size_, MADV_SEQUENTIAL);
+		}
+
+		close(fd);
+#else
+		fail("memory-mapped input is not supported on this platform:", path, failure_status);
+#endif
+	}
+
+	mapped_file(const mapped_file &) = delete;
+	mapped_file &operator=(const mapped_file &) = delete;
+
+	~mapped_file() {
+#if defined(__unix__) || defined(__APPLE__)
+		if (data_ != nullptr)
+			munmap(data_, size_);
+#endif
+	}
+
+	const void *data() const { return data_; }
+
+	std::size_t size() const { return size_; }
+
+	// drops the pages of the given byte range that were already read (keeps the resident set small)
+	void release(std::size_t offset, std::size_t length) const {
+#if defined(__unix__) || defined(__APPLE__)
+		const std::size_t page = sysconf(_SC_PAGESIZE);
+		const std::size_t begin = (offset + page - 1) / page * page;
+		const std::size_t end = (offset + length) / page * page;
+
+		if (data_ != nullptr && begin < end)
+			madvise((char *)data_ + begin, end - begin, MADV_DONTNEED);
+#else
+		(void)offset;
+		(void)length;
+#endif
+	}
+
+private:
+	void *data_ = nullptr;
+	std::size_t size_ = 0;
+
+	[[noreturn]] static void fail(const char *what, const std::string &path, int status) {
+		std::cerr << what << " " << path << std::endl;
+		std::exit(status);
+	}
+};
+
+} // namespace polybench
+
+#endif // NOARR_POLYBENCH_MAPPED_FILE_HPP
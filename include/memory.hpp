@@ -0,0 +1,472 @@
+#ifndef NOARR_POLYBENCH_MEMORY_HPP
+#define NOARR_POLYBENCH_MEMORY_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+# include <sys/mman.h>
+# include <sys/syscall.h>
+# include <unistd.h>
+#endif
+
+#include <noarr/traversers.hpp>
+
+#include "params.hpp"
+
+// the default of HUGE_PAGES (see polybench::memory), selected at build time
+#ifndef HUGE_PAGES_DEFAULT
+# define HUGE_PAGES_DEFAULT "off"
+#endif
+
+namespace polybench {
+
+// The partitioning of a buffer among the OpenMP threads of a parallel kernel variant: the blocks of `block`
+// indices of the dimension Dim, distributed as by `#pragma omp for schedule(static)` over the blocks
+//
+// Given to memory::make_bag, it is followed by the first touch of NUMA_POLICY=parallel. For the dynamic
+// schedules over the same blocks (e.g., the tiles of the blocked cholesky), it places each block on one node
+// and spreads the blocks over the nodes, but cannot predict which thread computes a block.
+template<char Dim>
+struct partition {
+	std::size_t block = 1;
+};
+
+// The buffers of the data of a kernel, placed on the NUMA nodes of the machine
+//
+// Parameters (see polybench::params):
+//   NUMA_POLICY  placement of the pages of the buffers:
+//                  serial (default)  left to the single-threaded initialization, i.e., mostly the node of the main thread
+//                  parallel          first touched by all OpenMP threads: each the elements of its part of the
+//                                    partition of the buffer given to make_bag (see polybench::partition);
+//                                    the buffers without a partition, each its contiguous byte range of them
+//                  interleave        round-robin over all the nodes (mbind)
+//                  local             the node of the main thread (mbind)
+//   NUMA_REPORT  report the number of pages of each buffer on each node after the runs (default off, Linux only),
+//                in the record of the harness (see placement) and on the error output (see report)
+//   HUGE_PAGES   the pages backing the buffers (default HUGE_PAGES_DEFAULT, i.e., the HUGE_PAGES option of CMake):
+//                  off      the base pages of the system
+//                  thp      transparent huge pages, requested by madvise(MADV_HUGEPAGE)
+//                  hugetlb  huge pages reserved in the hugetlbfs pool (MAP_HUGETLB); thp if the pool is exhausted
+//
+// Each buffer is aligned to a page (at least 64 bytes); with huge pages, to a huge page (2 MiB).
+// The bags returned by make_bag do not own their data; the buffers live as long as the memory object,
+// or, with share_buffers (e.g., in the polybench-noarr driver), until a later memory object reuses them.
+class memory {
+public:
+	explicit memory(const params &params)
+		: policy_(params.get<std::string>("NUMA_POLICY", "serial")),
+		  report_(params.get("NUMA_REPORT", false)),
+		  huge_pages_(params.get<std::string>("HUGE_PAGES", HUGE_PAGES_DEFAULT))
+	{
+		if (policy_ != "serial" && policy_ != "parallel" && policy_ != "interleave" && policy_ != "local") {
+			std::cerr << "invalid value of NUMA_POLICY: '" << policy_ << "'" << std::endl;
+			std::exit(EXIT_FAILURE);
+		}
+
+		if (huge_pages_ != "off" && huge_pages_ != "thp" && huge_pages_ != "hugetlb") {
+			std::cerr << "invalid value of HUGE_PAGES: '" << huge_pages_ << "'" << std::endl;
+			std::exit(EXIT_FAILURE);
+		}
+
+#ifndef __linux__
+		if (huge_pages_ != "off") {
+			std::cerr << "memory: HUGE_PAGES=" << huge_pages_ << " is not supported on this platform" << std::endl;
+			huge_pages_ = "off";
+		}
+#endif
+	}
+
+	memory(const memory &) = delete;
+	memory &operator=(const memory &) = delete;
+
+	~memory() {
+		for (const auto &buffer : buffers_) {
+			if (sharing() && buffer.size > 0)
+				shared_buffers().push_back(buffer);
+			else
+				deallocate(buffer);
+		}
+	}
+
+	// keeps the buffers of the destroyed memory objects in the process for the following ones to reuse
+	// (the smallest free one large enough, up to twice the size, with the same NUMA_POLICY and HUGE_PAGES), so a sequence
+	// of kernels maps and faults its pages in once; the pages keep their placement, so the buffers are
+	// not shared with NUMA_POLICY=parallel, which places them by the partitions of each kernel
+	static void share_buffers(bool enabled) {
+		sharing_enabled() = enabled;
+	}
+
+	// allocates a (non-owning) bag of the given structure
+	auto make_bag(auto structure) {
+		return noarr::make_bag(structure, allocate(structure | noarr::get_size(), true));
+	}
+
+	// allocates a (non-owning) bag of the given structure, first touched by the given partition with NUMA_POLICY=parallel
+	template<char Dim>
+	auto make_bag(auto structure, partition<Dim> partition) {
+		auto bag = noarr::make_bag(structure, allocate(structure | noarr::get_size(), false));
+
+		if (policy_ == "parallel")
+			first_touch(bag.get_ref(), partition);
+
+		return bag;
+	}
+
+	// the allocation settings in effect, for the report of the harness
+	std::vector<std::pair<std::string, std::string>> settings() const {
+		return {
+			{"numa_policy", policy_},
+			{"huge_pages", huge_pages_},
+			{"alignment", std::to_string(alignment())},
+			{"shared_buffers", sharing() ? "on" : "off"},
+		};
+	}
+
+	// the placement of the pages of the buffers (if NUMA_REPORT is on), for the report of the harness:
+	// numa_buffer<i> = node<n>:<pages>... (unmapped:<pages> for the pages not touched yet)
+	std::vector<std::pair<std::string, std::string>> placement() const {
+		std::vector<std::pair<std::string, std::string>> result;
+
+		if (!report_)
+			return result;
+
+		for (std::size_t i = 0; i < buffers_.size(); ++i) {
+			std::string pages;
+
+			for (const auto &[node, count] : node_pages(buffers_[i]))
+				pages += (pages.empty() ? "" : " ") + (node >= 0 ? "node" + std::to_string(node) : std::string("unmapped")) + ":" + std::to_string(count);
+
+			result.emplace_back("numa_buffer" + std::to_string(i), pages);
+		}
+
+		return result;
+	}
+
+	// prints the placement of the pages of the buffers (if NUMA_REPORT is on)
+	void report(std::ostream &out) const {
+		if (!report_)
+			return;
+
+		for (std::size_t i = 0; i < buffers_.size(); ++i) {
+			out << "numa: buffer " << i << " (" << std::fixed << std::setprecision(1)
+				<< buffers_[i].size / (1024.0 * 1024.0) << " MiB):";
+
+			for (const auto &[node, pages] : node_pages(buffers_[i]))
+				out << ' ' << (node >= 0 ? "node" + std::to_string(node) : "unmapped") << '=' << pages;
+
+			out << std::defaultfloat << std::endl;
+		}
+	}
+
+private:
+	struct buffer {
+		void *data;
+		std::size_t size;
+		std::size_t mapped; // the size of the mapping (rounded up to whole pages)
+		std::string pages; // NUMA_POLICY and HUGE_PAGES of the mapping (only the buffers of the same ones are shared)
+	};
+
+	// the buffers kept by share_buffers; they are unmapped at the exit of the process
+	struct buffer_pool : std::vector<buffer> {
+		buffer_pool() = default;
+		buffer_pool(const buffer_pool &) = delete;
+		buffer_pool &operator=(const buffer_pool &) = delete;
+
+		~buffer_pool() {
+			for (const auto &buffer : *this)
+				deallocate(buffer);
+		}
+	};
+
+	static bool &sharing_enabled() {
+		static bool enabled = false;
+		return enabled;
+	}
+
+	static buffer_pool &shared_buffers() {
+		static buffer_pool buffers;
+		return buffers;
+	}
+
+	static constexpr std::size_t huge_page_size = 2 << 20;
+	static constexpr std::size_t min_alignment = 64;
+
+	std::string policy_;
+	bool report_;
+	std::string huge_pages_;
+	std::vector<buffer> buffers_;
+
+	bool sharing() const {
+		return sharing_enabled() && policy_ != "parallel";
+	}
+
+	std::string pages() const {
+		return policy_ + "," + huge_pages_;
+	}
+
+	// the size of the mapping of a buffer (whole pages)
+	std::size_t mapping_size(std::size_t size) const {
+		return round_up(size, huge_pages_ != "off" ? huge_page_size : page_size());
+	}
+
+	// takes the smallest shared buffer with the current pages and a mapping of at least the one of the given size
+	// (and at most twice it), nullptr if none
+	void *reuse(std::size_t size) {
+		const std::size_t mapped = mapping_size(size);
+
+		auto &shared = shared_buffers();
+		auto best = shared.end();
+
+		for (auto it = shared.begin(); it != shared.end(); ++it)
+			if (it->pages == pages() && it->mapped >= mapped && it->mapped / 2 <= mapped && (best == shared.end() || it->mapped < best->mapped))
+				best = it;
+
+		if (best == shared.end())
+			return nullptr;
+
+		buffers_.push_back({best->data, size, best->mapped, best->pages});
+		shared.erase(best);
+
+		return buffers_.back().data;
+	}
+
+	std::size_t alignment() const {
+		return huge_pages_ != "off" ? huge_page_size : std::max(page_size(), min_alignment);
+	}
+
+	static std::size_t round_up(std::size_t size, std::size_t alignment) {
+		return (size + alignment - 1) / alignment * alignment;
+	}
+
+	static std::size_t page_size() {
+#ifdef __linux__
+		return sysconf(_SC_PAGESIZE);
+#else
+		return 4096;
+#endif
+	}
+
+	// `touch`: whether NUMA_POLICY=parallel is to touch the buffer by bytes (i.e., it has no partition)
+	void *allocate(std::size_t size, bool touch) {
+		// a shared buffer is already placed by the same policy
+		if (size > 0 && sharing()) {
+			if (void *data = reuse(size))
+				return data;
+		}
+
+		// the pages of a fresh mapping are not touched yet, so they are placed by the policy below
+#ifdef __linux__
+		std::size_t mapped = mapping_size(size);
+		void *data = nullptr;
+
+		if (size > 0 && huge_pages_ == "hugetlb") {
+			data = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+			if (data == MAP_FAILED) {
+				std::cerr << "memory: no huge pages left in the hugetlbfs pool (see /proc/sys/vm/nr_hugepages), HUGE_PAGES=thp used instead" << std::endl;
+				huge_pages_ = "thp";
+				data = nullptr;
+			}
+		}
+
+		if (size > 0 && huge_pages_ == "thp" && data == nullptr)
+			data = map_aligned(mapped);
+		else if (size > 0 && huge_pages_ == "off")
+			data = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+		if (data == MAP_FAILED)
+			throw std::bad_alloc();
+#else
+		const std::size_t mapped = mapping_size(size);
+		void *data = ::operator new(mapped, std::align_val_t(min_alignment));
+#endif
+
+		buffers_.push_back({data, size, mapped, pages()});
+
+		if (size == 0)
+			return data;
+
+		if (policy_ == "interleave" || policy_ == "local")
+			bind(data, size);
+		else if (policy_ == "parallel" && touch)
+			first_touch(data, size);
+
+		return data;
+	}
+
+	static void deallocate(const buffer &buffer) {
+#ifdef __linux__
+		if (buffer.data != nullptr)
+			munmap(buffer.data, buffer.mapped);
+#else
+		::operator delete(buffer.data, std::align_val_t(min_alignment));
+#endif
+	}
+
+#ifdef __linux__
+	// maps the given size (a multiple of the huge page size) aligned to a huge page and advises transparent huge pages for it
+	static void *map_aligned(std::size_t size) {
+		// the excess of the larger mapping is trimmed on both sides of the aligned part
+		const std::size_t excess = huge_page_size;
+		void *mapping = mmap(nullptr, size + excess, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+		if (mapping == MAP_FAILED)
+			return MAP_FAILED;
+
+		char *const begin = (char *)mapping;
+		char *const data = begin + (round_up((std::size_t)begin, huge_page_size) - (std::size_t)begin);
+
+		if (data > begin)
+			munmap(begin, data - begin);
+
+		if (data + size < begin + size + excess)
+			munmap(data + size, begin + size + excess - (data + size));
+
+		if (madvise(data, size, MADV_HUGEPAGE) != 0)
+			std::cerr << "memory: madvise(MADV_HUGEPAGE) failed (transparent huge pages disabled?)" << std::endl;
+
+		return data;
+	}
+#endif
+
+	// places the pages as if each thread of the parallel kernel variant touched the elements of its part of
+	// the partition first; a page shared by the parts of several threads goes to one of them
+	template<char Dim>
+	static void first_touch(auto bag, partition<Dim> partition) {
+		using namespace noarr;
+
+		const std::size_t length = bag | get_length<Dim>();
+		const std::size_t block = std::max(partition.block, (std::size_t)1);
+		const std::size_t blocks = (length + block - 1) / block;
+
+		#pragma omp parallel for schedule(static)
+		for (std::size_t b = 0; b < blocks; ++b) {
+			traverser(bag) ^ span<Dim>(b * block, std::min((b + 1) * block, length)) | [=](auto state) {
+				bag[state] = {};
+			};
+		}
+	}
+
+	// places the pages of a buffer without a partition as if each thread of `#pragma omp for schedule(static)`
+	// over the pages touched its iterations first; this matches the static schedule over the outermost
+	// dimension of a row-major (outermost-first) layout only, and none of the kernels without a fixed
+	// partitioning (e.g., the tasks of the tiled lu or the wavefronts of nussinov and heat-3d), which are
+	// better served by NUMA_POLICY=interleave
+	static void first_touch(void *data, std::size_t size) {
+		const std::size_t page = page_size();
+		const std::size_t pages = (size + page - 1) / page;
+
+		auto *bytes = (volatile char *)data;
+
+		#pragma omp parallel for schedule(static)
+		for (std::size_t p = 0; p < pages; ++p)
+			bytes[p * page] = 0;
+	}
+
+	// the online NUMA nodes, as a bit mask for mbind
+	static std::vector<unsigned long> node_mask() {
+		std::vector<unsigned long> mask;
+
+		std::ifstream online("/sys/devices/system/node/online");
+		std::string ranges;
+
+		if (!(online >> ranges))
+			ranges = "0";
+
+		constexpr std::size_t bits = 8 * sizeof(unsigned long);
+
+		// e.g. "0-1,3"
+		for (std::size_t pos = 0; pos < ranges.size();) {
+			std::size_t end = ranges.find(',', pos);
+			end = end == std::string::npos ? ranges.size() : end;
+
+			const std::string range = ranges.substr(pos, end - pos);
+			const std::size_t dash = range.find('-');
+			const std::size_t first = std::stoul(range.substr(0, dash));
+			const std::size_t last = dash == std::string::npos ? first : std::stoul(range.substr(dash + 1));
+
+			for (std::size_t node = first; node <= last; ++node) {
+				if (mask.size() <= node / bits)
+					mask.resize(node / bits + 1);
+
+				mask[node / bits] |= 1ul << node % bits;
+			}
+
+			pos = end + 1;
+		}
+
+		return mask;
+	}
+
+	void bind(void *data, std::size_t size) const {
+#ifdef __linux__
+		// from <linux/mempolicy.h>
+		constexpr int mpol_preferred = 1;
+		constexpr int mpol_interleave = 3;
+
+		const auto mask = node_mask();
+		const bool interleave = policy_ == "interleave";
+
+		// MPOL_PREFERRED with an empty mask is the local allocation
+		const long result = interleave
+			? syscall(SYS_mbind, data, size, mpol_interleave, mask.data(), 8 * sizeof(unsigned long) * mask.size() + 1, 0)
+			: syscall(SYS_mbind, data, size, mpol_preferred, nullptr, 0, 0);
+
+		if (result != 0)
+			std::cerr << "numa: mbind failed, NUMA_POLICY=" << policy_ << " ignored" << std::endl;
+#else
+		(void)data;
+		(void)size;
+		std::cerr << "numa: NUMA_POLICY=" << policy_ << " is not supported on this platform" << std::endl;
+#endif
+	}
+
+	// the number of pages of the buffer on each node (-1 for the pages not mapped yet)
+	static std::map<int, std::size_t> node_pages(const buffer &buffer) {
+		std::map<int, std::size_t> result;
+
+#ifdef __linux__
+		const std::size_t page = page_size();
+		const std::size_t pages = (buffer.size + page - 1) / page;
+
+		constexpr std::size_t batch = 4096;
+
+		std::vector<void *> addresses(batch);
+		std::vector<int> status(batch);
+
+		for (std::size_t first = 0; first < pages; first += batch) {
+			const std::size_t count = std::min(batch, pages - first);
+
+			for (std::size_t p = 0; p < count; ++p)
+				addresses[p] = (char *)buffer.data + (first + p) * page;
+
+			// move_pages without target nodes only queries the current ones
+			if (syscall(SYS_move_pages, 0, count, addresses.data(), nullptr, status.data(), 0) != 0) {
+				result[-1] += count;
+				continue;
+			}
+
+			for (std::size_t p = 0; p < count; ++p)
+				++result[status[p] >= 0 ? status[p] : -1];
+		}
+#else
+		(void)buffer;
+#endif
+
+		return result;
+	}
+};
+
+} // namespace polybench
+
+#endif // NOARR_POLYBENCH_MEMORY_HPP
@@ -0,0 +1,63 @@
+#ifndef NOARR_POLYBENCH_NPY_HPP
+#define NOARR_POLYBENCH_NPY_HPP
+
+#include <bit>
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace polybench {
+
+// returns the numpy type descriptor of T (e.g. "<f8" for a little-endian double)
+template<class T>
+std::string npy_descr() {
+	static_assert(std::is_arithmetic_v<T>, "only arithmetic types can be stored in .npy");
+
+	std::string descr = std::endian::native == std::endian::little ? "<" : ">";
+
+	if constexpr (std::is_floating_point_v<T>)
+		descr += 'f';
+	else if constexpr (std::is_signed_v<T>)
+		descr += 'i';
+	else
+		descr += 'u';
+
+	return descr + std::to_string(sizeof(T));
+}
+
+// writes a C-order array in the .npy format (version 1.0)
+//
+// The header is padded so that the data of an array written at a 64-byte
+// aligned offset is 64-byte aligned as well.
+template<class T>
+void write_npy(std::ostream &out, const T *data, const std::vector<std::size_t> &shape) {
+	std::string header = "{'descr': '" + npy_descr<T>() + "', 'fortran_order': False, 'shape': (";
+
+	std::size_t count = 1;
+
+	for (std::size_t i = 0; i < shape.size(); ++i) {
+		header += (i ? ", " : "") + std::to_string(shape[i]);
+		count *= shape[i];
+	}
+
+	header += shape.size() == 1 ? ",), }" : "), }";
+
+	// magic string, version, header length, header, '\n'
+	constexpr std::size_t preamble = 6 + 2 + 2;
+	const std::size_t padded = (preamble + header.size() + 1 + 63) / 64 * 64;
+
+	header.append(padded - preamble - header.size() - 1, ' ');
+	header += '\n';
+
+	out.write("\x93NUMPY\x01\x00", 8);
+	out.put((char)(header.size() & 0xff));
+	out.put((char)(header.size() >> 8));
+	out.write(header.data(), header.size());
+	out.write((const char *)data, count * sizeof(T));
+}
+
+} // namespace polybench
+
+#endif // NOARR_POLYBENCH_NPY_HPP
@@ -0,0 +1,88 @@
+#ifndef NOARR_POLYBENCH_PARAMS_HPP
+#define NOARR_POLYBENCH_PARAMS_HPP
+
+#include <charconv>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+
+namespace polybench {
+
+// Runtime parameters of a benchmark
+//
+// A parameter `NAME` is given either as a `NAME=value` command-line argument
+// or as the `POLYBENCH_NAME` environment variable (the command line wins).
+// Parameters that are not given fall back to the compile-time defaults,
+// e.g. the problem sizes of the selected *_DATASET preset.
+class params {
+public:
+	params(int argc, char *argv[]) : argc_(argc), argv_(argv) {}
+
+	// returns the value of the parameter or nullptr if it is not given
+	const char *find(std::string_view name) const {
+		for (int i = 1; i < argc_; ++i) {
+			std::string_view arg = argv_[i];
+
+			if (arg.size() > name.size() && arg.starts_with(name) && arg[name.size()] == '=')
+				return argv_[i] + name.size() + 1;
+		}
+
+		return std::getenv(("POLYBENCH_" + std::string(name)).c_str());
+	}
+
+	std::size_t size(std::string_view name, std::size_t default_value) const {
+		return get(name, default_value);
+	}
+
+	template<class T>
+	T get(std::string_view name, T default_value) const {
+		const char *value = find(name);
+
+		if (value == nullptr)
+			return default_value;
+
+		if constexpr (std::is_same_v<T, bool>) {
+			std::string_view str = value;
+
+			if (str == "1" || str == "on" || str == "yes" || str == "true")
+				return true;
+			if (str == "0" || str == "off" || str == "no" || str == "false")
+				return false;
+
+			invalid(name, value);
+		} else if constexpr (std::is_constructible_v<T, const char *>) {
+			return T(value);
+		} else {
+			std::string_view str = value;
+			T result;
+
+			auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), result);
+
+			if (ec != std::errc() || ptr != str.data() + str.size())
+				invalid(name, value);
+
+			return result;
+		}
+	}
+
+	int argc() const { return argc_; }
+	char **argv() const { return argv_; }
+
+private:
+	int argc_;
+	char **argv_;
+
+	[[noreturn]]
+	static void invalid(std::string_view name, std::string_view value) {
+		std::cerr << "invalid value of " << name << ": '" << value << "'" << std::endl;
+		std::exit(EXIT_FAILURE);
+	}
+};
+
+} // namespace polybench
+
+#endif // NOARR_POLYBENCH_PARAMS_HPP
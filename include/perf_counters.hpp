@@ -0,0 +1,194 @@
+#ifndef NOARR_POLYBENCH_PERF_COUNTERS_HPP
+#define NOARR_POLYBENCH_PERF_COUNTERS_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+# include <linux/perf_event.h>
+# include <sys/ioctl.h>
+# include <sys/syscall.h>
+# include <unistd.h>
+#endif
+
+#ifdef _OPENMP
+# include <omp.h>
+#endif
+
+namespace polybench {
+
+// Hardware performance counters read through Linux perf_event_open
+//
+// Each thread of the OpenMP thread pool (started here if it does not exist yet)
+// gets its own set of counters, and the values of a run are summed over them;
+// counting on threads that already exist does not rely on perf inheritance,
+// which only covers the threads created after a counter is opened. The counters
+// of the calling thread also cover the threads it creates afterwards (e.g. if
+// a kernel asks for more threads than the pool has). User space only.
+// Counters the machine (or the perf_event_paranoid setting) does not allow are
+// reported as unavailable (-1).
+class perf_counters {
+public:
+	static constexpr std::size_t count = 6;
+
+	static constexpr const char *names[count] = {
+		"cycles",
+		"instructions",
+		"l1d_misses",
+		"llc_misses",
+		"dtlb_misses",
+		"branch_misses",
+	};
+
+	using values = std::array<std::int64_t, count>;
+
+	explicit perf_counters(bool enable = false) {
+		if (!enable)
+			return;
+
+#ifdef __linux__
+# ifdef _OPENMP
+		std::array<int, count> none;
+		none.fill(-1);
+
+		fds_.resize(omp_get_max_threads(), none);
+
+		// each thread opens the counters of itself
+		#pragma omp parallel num_threads(fds_.size())
+		fds_[omp_get_thread_num()] = open_thread(omp_get_thread_num() == 0);
+# else
+		fds_.push_back(open_thread(true));
+# endif
+
+		if (!enabled())
+			std::cerr << "perf counters are not available (see /proc/sys/kernel/perf_event_paranoid)" << std::endl;
+#else
+		std::cerr << "perf counters are only supported on Linux" << std::endl;
+#endif
+	}
+
+	perf_counters(const perf_counters &) = delete;
+	perf_counters &operator=(const perf_counters &) = delete;
+
+	~perf_counters() {
+#ifdef __linux__
+		for (const auto &thread : fds_)
+			for (int fd : thread)
+				if (fd != -1)
+					close(fd);
+#endif
+	}
+
+	bool enabled() const {
+		for (const auto &thread : fds_)
+			for (int fd : thread)
+				if (fd != -1)
+					return true;
+
+		return false;
+	}
+
+	// the number of threads the counters are summed over
+	std::size_t threads() const { return fds_.size(); }
+
+	void start() {
+#ifdef __linux__
+		for (const auto &thread : fds_) {
+			for (int fd : thread) {
+				if (fd != -1) {
+					ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+					ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+				}
+			}
+		}
+#endif
+	}
+
+	values stop() {
+		values result;
+		result.fill(-1);
+
+#ifdef __linux__
+		for (const auto &thread : fds_)
+			for (int fd : thread)
+				if (fd != -1)
+					ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+
+		for (const auto &thread : fds_) {
+			for (std::size_t i = 0; i < count; ++i) {
+				std::uint64_t data[3]; // value, time enabled, time running
+
+				if (thread[i] == -1 || read(thread[i], data, sizeof(data)) != sizeof(data))
+					continue;
+
+				// an idle thread has nothing to count
+				if (data[2] == 0) {
+					result[i] = std::max<std::int64_t>(result[i], 0);
+					continue;
+				}
+
+				// the kernel multiplexes the counters if there are not enough of them
+				if (data[2] < data[1])
+					data[0] = (std::uint64_t)((double)data[0] * data[1] / data[2]);
+
+				result[i] = std::max<std::int64_t>(result[i], 0) + data[0];
+			}
+		}
+#endif
+
+		return result;
+	}
+
+private:
+	// the counters of each thread (-1 if unavailable)
+	std::vector<std::array<int, count>> fds_;
+
+#ifdef __linux__
+	// opens the counters of the calling thread; the inherited ones also cover the threads it creates afterwards
+	static std::array<int, count> open_thread(bool inherit) {
+		constexpr auto cache_miss = [](std::uint64_t cache) {
+			return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+		};
+
+		const std::pair<std::uint32_t, std::uint64_t> events[count] = {
+			{PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+			{PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+			{PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_L1D)},
+			{PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_LL)},
+			{PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_DTLB)},
+			{PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+		};
+
+		std::array<int, count> fds;
+
+		for (std::size_t i = 0; i < count; ++i) {
+			perf_event_attr attr;
+			std::memset(&attr, 0, sizeof(attr));
+
+			attr.size = sizeof(attr);
+			attr.type = events[i].first;
+			attr.config = events[i].second;
+			attr.disabled = 1;
+			attr.inherit = inherit;
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+			attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+			// the calling thread on any CPU
+			fds[i] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+		}
+
+		return fds;
+	}
+#endif
+};
+
+} // namespace polybench
+
+#endif // NOARR_POLYBENCH_PERF_COUNTERS_HPP
@@ -0,0 +1,314 @@
+#ifndef NOARR_POLYBENCH_REPORT_HPP
+#define NOARR_POLYBENCH_REPORT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+#if __has_include(<cxxabi.h>)
+# include <cxxabi.h>
+#endif
+
+#include "defines.hpp"
+#include "perf_counters.hpp"
+#include "roofline.hpp"
+#include "statistics.hpp"
+
+namespace polybench {
+
+// returns the (demangled) name of the type of the given tuning proto-structure
+template<class T>
+std::string type_name(const T &) {
+	const char *name = typeid(T).name();
+
+#if __has_include(<cxxabi.h>)
+	int status = 0;
+	char *demangled = abi::__cxa_demangle(name, nullptr, nullptr, &status);
+
+	if (status == 0 && demangled != nullptr) {
+		std::string result = demangled;
+		std::free(demangled);
+		return result;
+	}
+#endif
+
+	return name;
+}
+
+// Everything known about a measured kernel
+struct record {
+	std::string kernel;
+	std::vector<std::pair<std::string, std::size_t>> lengths;
+	std::vector<std::pair<std::string, std::string>> tuning;
+
+	// settings of the environment the kernel ran in (e.g. the allocation of its data)
+	std::vector<std::pair<std::string, std::string>> environment;
+
+	// floating-point operations and compulsory memory traffic (bytes) of a single run (0 if unknown)
+	double flops = 0;
+	double bytes = 0;
+
+	// ceilings of the machine: peak GFLOP/s and STREAM bandwidth in GB/s (0 if unknown)
+	double peak_gflops = 0;
+	double stream_bandwidth = 0;
+
+	// run times in seconds
+	std::vector<double> times;
+
+	// hardware counters of each run (empty unless measured)
+	std::vector<perf_counters::values> counters;
+
+	polybench::roofline roofline(double time) const {
+		return polybench::roofline::of(flops, bytes, time, peak_gflops, stream_bandwidth);
+	}
+};
+
+namespace detail {
+
+inline void write_json_string(std::ostream &out, std::string_view str) {
+	out << '"';
+
+	for (char c : str) {
+		switch (c) {
+		case '"':
+			out << "\\\"";
+			break;
+		case '\\':
+			out << "\\\\";
+			break;
+		case '\n':
+			out << "\\n";
+			break;
+		default:
+			out << c;
+		}
+	}
+
+	out << '"';
+}
+
+inline void write_csv_string(std::ostream &out, std::string_view str) {
+	out << '"';
+
+	for (char c : str) {
+		if (c == '"')
+			out << '"';
+		out << c;
+	}
+
+	out << '"';
+}
+
+} // namespace detail
+
+// writes the run time as a plain number; for multiple runs, writes their statistics;
+// followed by the achieved rates if the flops or bytes of the kernel are known
+inline void write_text(std::ostream &out, const record &record) {
+	out << std::fixed << std::setprecision(6);
+
+	if (record.times.size() == 1) {
+		out << record.times.front() << std::endl;
+	} else {
+		const auto stats = statistics::of(record.times);
+
+		out << "runs=" << stats.runs
+		    << " min=" << stats.min
+		    << " median=" << stats.median
+		    << " mean=" << stats.mean
+		    << " stddev=" << stats.stddev
+		    << " ci95=[" << stats.ci_low << ", " << stats.ci_high << "]" << std::endl;
+	}
+
+	// the achieved rates (of the median run); the shares of the ceilings only if they are known
+	if (record.flops > 0 || record.bytes > 0) {
+		const auto roofline = record.roofline(statistics::of(record.times).median);
+
+		out << std::setprecision(2)
+		    << "gflops=" << roofline.gflops
+		    << " gbs=" << roofline.bandwidth
+		    << " intensity=" << roofline.intensity;
+
+		if (record.peak_gflops > 0)
+			out << " peak=" << roofline.pct_peak << "%";
+
+		if (record.stream_bandwidth > 0)
+			out << " bandwidth=" << roofline.pct_bandwidth << "%";
+
+		if (record.peak_gflops > 0 && record.stream_bandwidth > 0)
+			out << " bound=" << roofline.bound;
+
+		out << std::endl;
+	}
+
+	if (record.counters.empty())
+		return;
+
+	// medians over the runs
+	for (std::size_t i = 0; i < perf_counters::count; ++i) {
+		std::vector<double> values;
+
+		for (const auto &counters : record.counters)
+			if (counters[i] >= 0)
+				values.push_back(counters[i]);
+
+		out << (i ? " " : "") << perf_counters::names[i] << "=";
+
+		if (values.empty())
+			out << "n/a";
+		else
+			out << (std::int64_t)statistics::of(values).median;
+	}
+
+	out << std::endl;
+}
+
+// writes the record as a single line of JSON
+inline void write_json(std::ostream &out, const record &record) {
+	const auto stats = statistics::of(record.times);
+
+	out << std::defaultfloat << std::setprecision(9);
+
+	out << "{\"kernel\":";
+	detail::write_json_string(out, record.kernel);
+	out << ",\"dataset\":\"" << DATASET_SIZE << "\"";
+	out << ",\"data_type\":\"" << DATA_TYPE_CHOICE << "\"";
+
+	out << ",\"lengths\":{";
+	for (std::size_t i = 0; i < record.lengths.size(); ++i) {
+		out << (i ? "," : "");
+		detail::write_json_string(out, record.lengths[i].first);
+		out << ":" << record.lengths[i].second;
+	}
+	out << "}";
+
+	out << ",\"tuning\":{";
+	for (std::size_t i = 0; i < record.tuning.size(); ++i) {
+		out << (i ? "," : "");
+		detail::write_json_string(out, record.tuning[i].first);
+		out << ":";
+		detail::write_json_string(out, record.tuning[i].second);
+	}
+	out << "}";
+
+	out << ",\"environment\":{";
+	for (std::size_t i = 0; i < record.environment.size(); ++i) {
+		out << (i ? "," : "");
+		detail::write_json_string(out, record.environment[i].first);
+		out << ":";
+		detail::write_json_string(out, record.environment[i].second);
+	}
+	out << "}";
+
+	out << ",\"times\":[";
+	for (std::size_t i = 0; i < record.times.size(); ++i)
+		out << (i ? "," : "") << record.times[i];
+	out << "]";
+
+	out << ",\"min\":" << stats.min
+	    << ",\"median\":" << stats.median
+	    << ",\"mean\":" << stats.mean
+	    << ",\"stddev\":" << stats.stddev
+	    << ",\"ci95\":[" << stats.ci_low << "," << stats.ci_high << "]";
+
+	if (!record.counters.empty()) {
+		out << ",\"counters\":{";
+		for (std::size_t i = 0; i < perf_counters::count; ++i) {
+			out << (i ? "," : "") << "\"" << perf_counters::names[i] << "\":[";
+			for (std::size_t run = 0; run < record.counters.size(); ++run) {
+				out << (run ? "," : "");
+				if (record.counters[run][i] >= 0)
+					out << record.counters[run][i];
+				else
+					out << "null";
+			}
+			out << "]";
+		}
+		out << "}";
+	}
+
+	const auto roofline = record.roofline(stats.median);
+
+	out << ",\"flops\":" << record.flops
+	    << ",\"bytes\":" << record.bytes
+	    << ",\"gflops\":" << roofline.gflops
+	    << ",\"gflops_best\":" << record.roofline(stats.min).gflops
+	    << ",\"gbs\":" << roofline.bandwidth
+	    << ",\"intensity\":" << roofline.intensity;
+
+	if (record.peak_gflops > 0)
+		out << ",\"peak_gflops\":" << record.peak_gflops << ",\"pct_peak\":" << roofline.pct_peak;
+
+	if (record.stream_bandwidth > 0)
+		out << ",\"stream_bandwidth\":" << record.stream_bandwidth << ",\"pct_bandwidth\":" << roofline.pct_bandwidth;
+
+	if (record.peak_gflops > 0 && record.stream_bandwidth > 0)
+		out << ",\"bound\":\"" << roofline.bound << "\"";
+
+	out << "}" << std::endl;
+}
+
+// writes the record as CSV, one row per run
+inline void write_csv(std::ostream &out, const record &record, bool header) {
+	if (header) {
+		out << "kernel,dataset,data_type,lengths,tuning,run,time,gflops,gbs,intensity,pct_peak,pct_bandwidth";
+		for (const char *name : perf_counters::names)
+			out << "," << name;
+		out << ",environment" << std::endl;
+	}
+
+	std::string lengths;
+	for (const auto &[name, value] : record.lengths)
+		lengths += (lengths.empty() ? "" : ";") + name + "=" + std::to_string(value);
+
+	std::string tuning;
+	for (const auto &[name, value] : record.tuning)
+		tuning += (tuning.empty() ? "" : ";") + name + "=" + value;
+
+	std::string environment;
+	for (const auto &[name, value] : record.environment)
+		environment += (environment.empty() ? "" : ";") + name + "=" + value;
+
+	out << std::defaultfloat << std::setprecision(9);
+
+	for (std::size_t run = 0; run < record.times.size(); ++run) {
+		detail::write_csv_string(out, record.kernel);
+		out << "," << DATASET_SIZE << "," << DATA_TYPE_CHOICE << ",";
+		detail::write_csv_string(out, lengths);
+		out << ",";
+		detail::write_csv_string(out, tuning);
+		const auto roofline = record.roofline(record.times[run]);
+
+		out << "," << run << "," << record.times[run]
+		    << "," << roofline.gflops << "," << roofline.bandwidth << "," << roofline.intensity;
+
+		out << ",";
+		if (record.peak_gflops > 0)
+			out << roofline.pct_peak;
+
+		out << ",";
+		if (record.stream_bandwidth > 0)
+			out << roofline.pct_bandwidth;
+
+		for (std::size_t i = 0; i < perf_counters::count; ++i) {
+			out << ",";
+			if (run < record.counters.size() && record.counters[run][i] >= 0)
+				out << record.counters[run][i];
+		}
+
+		out << ",";
+		detail::write_csv_string(out, environment);
+
+		out << std::endl;
+	}
+}
+
+} // namespace polybench
+
+#endif // NOARR_POLYBENCH_REPORT_HPP
@@ -0,0 +1,193 @@
+#ifndef NOARR_POLYBENCH_RESULTS_HPP
+#define NOARR_POLYBENCH_RESULTS_HPP
+
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <noarr/traversers.hpp>
+
+#include "checksum.hpp"
+#include "npy.hpp"
+#include "params.hpp"
+
+namespace polybench {
+
+// Output of the computed results of a kernel
+//
+// Parameters (see polybench::params):
+//   RESULT_FORMAT  text (default; the noarr::serialize_data dump), npy, or checksum
+//   RESULT_FILE    npy: the stem of the .npy files (required); checksum: write the checksums to the given file
+//                  instead of the standard output
+//   REFERENCE      validate the checksums against the given file (written by an earlier run)
+//   TOLERANCE      the accepted relative error of a result that is not identical to its reference (default 0)
+//   TOLERANCE_FLOOR  the smallest magnitude the errors are taken relative to (default 1e-30), i.e., the errors
+//                  of the values (blocks) smaller than it are absolute
+//
+// In the npy format, each result is written as a .npy file in C order of the
+// listed dimensions, named `<stem>.<name>.<dims>.npy` (e.g. `out.C.ij.npy` for
+// RESULT_FILE=out), so that `numpy.load` (also with `mmap_mode`) reads it and
+// the name tells the order of its axes.
+//
+// In the checksum format, each result is summarized by a polybench::checksum
+// of its values in the same order. With a REFERENCE, a summary of the errors of
+// each result is printed to the standard error output; a result that differs
+// from its reference by more than TOLERANCE (in the sum of any block relative
+// to the sum of its absolute values, in the norm of any block, or in the norm
+// of the result) terminates the program with a failure, and so does a result
+// missing in the reference or in the output.
+class results {
+public:
+	explicit results(const params &params)
+		: format_(params.get<std::string>("RESULT_FORMAT", "text"))
+	{
+		if (format_ != "text" && format_ != "npy" && format_ != "checksum") {
+			std::cerr << "invalid value of RESULT_FORMAT: '" << format_ << "'" << std::endl;
+			std::exit(EXIT_FAILURE);
+		}
+
+		if (format_ == "npy") {
+			stem_ = params.get<std::string>("RESULT_FILE", "");
+
+			if (stem_.empty()) {
+				std::cerr << "RESULT_FORMAT=npy requires RESULT_FILE (the stem of the .npy files)" << std::endl;
+				std::exit(EXIT_FAILURE);
+			}
+
+			if (stem_.ends_with(".npy"))
+				stem_.resize(stem_.size() - 4);
+		} else if (std::string path = params.get<std::string>("RESULT_FILE", ""); !path.empty() && format_ == "checksum") {
+			file_.open(path, std::ios::binary);
+
+			if (!file_) {
+				std::cerr << "cannot open " << path << std::endl;
+				std::exit(EXIT_FAILURE);
+			}
+		}
+
+		if (std::string path = params.get<std::string>("REFERENCE", ""); !path.empty() && format_ == "checksum") {
+			std::ifstream file(path);
+
+			if (!file) {
+				std::cerr << "cannot open " << path << std::endl;
+				std::exit(EXIT_FAILURE);
+			}
+
+			for (checksum reference; read_checksum(file, reference);)
+				references_.push_back(std::move(reference));
+
+			if (!file.eof()) {
+				std::cerr << "malformed checksum in " << path << std::endl;
+				std::exit(EXIT_FAILURE);
+			}
+
+			validate_ = true;
+			tolerance_ = params.get("TOLERANCE", 0.0);
+			floor_ = params.get("TOLERANCE_FLOOR", 1e-30);
+		}
+	}
+
+	results(const results &) = delete;
+	results &operator=(const results &) = delete;
+
+	// a reference with results the run did not write (e.g. a kernel that stopped writing one) fails as well
+	~results() {
+		if (validate_ && index_ < references_.size()) {
+			std::cerr << "result " << index_ << ": missing in the output (the reference has " << references_.size()
+				<< " results, the run wrote " << index_ << ")" << std::endl;
+			std::exit(EXIT_FAILURE);
+		}
+	}
+
+	// whether the results are printed as text by the kernel itself
+	bool text() const { return format_ == "text"; }
+
+	// writes a result, its dimensions listed from the outermost
+	template<char... Dims>
+	void write(std::string_view name, auto bag) {
+		using namespace noarr;
+
+		using value_t = std::remove_cvref_t<decltype(bag[(idx<Dims>(0) & ...)])>;
+
+		auto ordered = bag ^ reorder<Dims...>();
+
+		std::vector<value_t> values;
+		values.reserve(((bag | get_length<Dims>()) * ...));
+
+		traverser(ordered) | [&](auto state) {
+			values.push_back(ordered[state]);
+		};
+
+		if (format_ == "npy") {
+			const std::string path = stem_ + "." + std::string(name) + "." + std::string{Dims...} + ".npy";
+			std::ofstream file(path, std::ios::binary);
+
+			write_npy(file, values.data(), {(bag | get_length<Dims>())...});
+
+			if (!file) {
+				std::cerr << "cannot write " << path << std::endl;
+				std::exit(EXIT_FAILURE);
+			}
+		} else
+			record(make_checksum(values.data(), values.size()));
+	}
+
+private:
+	std::string format_;
+	std::string stem_;
+	std::ofstream file_;
+
+	bool validate_ = false;
+	double tolerance_ = 0;
+	double floor_ = 0;
+	std::vector<checksum> references_;
+	std::size_t index_ = 0;
+
+	std::ostream &out() {
+		return file_.is_open() ? file_ : std::cout;
+	}
+
+	// writes the checksum of a result and validates it against the reference
+	void record(const checksum &checksum) {
+		write_checksum(out(), checksum);
+
+		const std::size_t index = index_++;
+
+		if (!validate_)
+			return;
+
+		if (index >= references_.size()) {
+			std::cerr << "result " << index << ": missing in the reference" << std::endl;
+			std::exit(EXIT_FAILURE);
+		}
+
+		const auto diff = compare_checksums(references_[index], checksum, floor_);
+
+		if (diff.identical) {
+			std::cerr << "result " << index << ": identical" << std::endl;
+			return;
+		}
+
+		std::cerr << "result " << index << ": max block sum diff " << diff.max_block_sum_diff
+			<< ", rel block sum diff " << diff.rel_block_sum_diff
+			<< ", rel block norm diff " << diff.rel_block_norm_diff
+			<< ", rel norm diff " << diff.rel_norm_diff
+			<< ", rel sum diff " << diff.rel_sum_diff << std::endl;
+
+		if (checksum.count != references_[index].count || checksum.block_sums.size() != references_[index].block_sums.size() ||
+			!(diff.rel_block_sum_diff <= tolerance_ && diff.rel_block_norm_diff <= tolerance_ && diff.rel_norm_diff <= tolerance_)) {
+			std::cerr << "result " << index << ": differs from the reference" << std::endl;
+			std::exit(EXIT_FAILURE);
+		}
+	}
+};
+
+} // namespace polybench
+
+#endif // NOARR_POLYBENCH_RESULTS_HPP
@@ -0,0 +1,87 @@
+#ifndef NOARR_POLYBENCH_ROOFLINE_HPP
+#define NOARR_POLYBENCH_ROOFLINE_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+namespace polybench {
+
+// Position of a kernel run in the roofline model
+//
+// `peak_gflops` and `bandwidth` (GB/s) are the ceilings of the machine; zero if unknown.
+//
+// The flop counts of the kernels follow the usual algorithmic convention (as in BLAS):
+// a multiply-add is two operations, and a scalar factor of a sum (alpha, beta) is counted
+// once per element it scales, not once per term; e.g. 2*ni*nj*nk + ni*nj for gemm.
+struct roofline {
+	double gflops = 0;
+	double bandwidth = 0; // achieved GB/s
+	double intensity = 0; // flops per byte
+
+	double pct_peak = 0; // of peak_gflops
+	double pct_bandwidth = 0; // of the ceiling bandwidth
+	const char *bound = "unknown"; // "memory" or "compute" (by the ridge point)
+
+	static roofline of(double flops, double bytes, double time, double peak_gflops, double ceiling) {
+		roofline result;
+
+		if (time > 0) {
+			result.gflops = flops / time * 1e-9;
+			result.bandwidth = bytes / time * 1e-9;
+		}
+
+		if (bytes > 0)
+			result.intensity = flops / bytes;
+
+		if (peak_gflops > 0)
+			result.pct_peak = result.gflops / peak_gflops * 100;
+
+		if (ceiling > 0)
+			result.pct_bandwidth = result.bandwidth / ceiling * 100;
+
+		if (peak_gflops > 0 && ceiling > 0 && bytes > 0)
+			result.bound = result.intensity * ceiling < peak_gflops ? "memory" : "compute";
+
+		return result;
+	}
+};
+
+// measures the STREAM triad bandwidth (GB/s) over three arrays of the given total size
+inline double measure_stream_bandwidth(std::size_t bytes, std::size_t repetitions = 10) {
+	const std::size_t n = bytes / (3 * sizeof(double));
+
+	std::vector<double> a(n, 1.0);
+	std::vector<double> b(n, 2.0);
+	std::vector<double> c(n, 0.5);
+
+	double *__restrict__ pa = a.data();
+	const double *__restrict__ pb = b.data();
+	const double *__restrict__ pc = c.data();
+
+	double best = 0;
+
+	for (std::size_t rep = 0; rep < repetitions; ++rep) {
+		auto start = std::chrono::high_resolution_clock::now();
+
+#ifdef _OPENMP
+		#pragma omp parallel for schedule(static)
+#endif
+		for (std::size_t i = 0; i < n; ++i)
+			pa[i] = pb[i] + 3.0 * pc[i];
+
+		auto end = std::chrono::high_resolution_clock::now();
+
+		const double time = std::chrono::duration<double>(end - start).count();
+
+		if (time > 0)
+			best = std::max(best, 3 * n * sizeof(double) / time * 1e-9);
+	}
+
+	return best;
+}
+
+} // namespace polybench
+
+#endif // NOARR_POLYBENCH_ROOFLINE_HPP
@@ -0,0 +1,76 @@
+#ifndef NOARR_POLYBENCH_STATISTICS_HPP
+#define NOARR_POLYBENCH_STATISTICS_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iterator>
+#include <numeric>
+#include <vector>
+
+namespace polybench {
+
+// Summary of the measured run times (in seconds)
+struct statistics {
+	std::size_t runs = 0;
+
+	double min = 0;
+	double median = 0;
+	double mean = 0;
+	double stddev = 0;
+
+	// 95% confidence interval of the mean
+	double ci_low = 0;
+	double ci_high = 0;
+
+	static statistics of(std::vector<double> times) {
+		statistics stats;
+
+		if (times.empty())
+			return stats;
+
+		std::sort(times.begin(), times.end());
+
+		const std::size_t n = times.size();
+
+		stats.runs = n;
+		stats.min = times.front();
+		stats.median = n % 2 ? times[n / 2] : (times[n / 2 - 1] + times[n / 2]) / 2;
+		stats.mean = std::accumulate(times.begin(), times.end(), 0.0) / n;
+
+		if (n > 1) {
+			double sum_sq = 0;
+
+			for (double time : times)
+				sum_sq += (time - stats.mean) * (time - stats.mean);
+
+			stats.stddev = std::sqrt(sum_sq / (n - 1));
+		}
+
+		const double half_width = student_t(n - 1) * stats.stddev / std::sqrt((double)n);
+
+		stats.ci_low = stats.mean - half_width;
+		stats.ci_high = stats.mean + half_width;
+
+		return stats;
+	}
+
+private:
+	// two-sided 95% quantile of the Student's t-distribution
+	static double student_t(std::size_t dof) {
+		constexpr double table[] = {
+			0, 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+			2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+			2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042,
+		};
+
+		if (dof < std::size(table))
+			return table[dof];
+
+		return 1.960;
+	}
+};
+
+} // namespace polybench
+
+#endif // NOARR_POLYBENCH_STATISTICS_HPP
@@ -0,0 +1,39 @@
+#ifndef NOARR_POLYBENCH_TRIANGLE_HPP
+#define NOARR_POLYBENCH_TRIANGLE_HPP
+
+#include <cmath>
+#include <cstddef>
+
+namespace polybench {
+
+// A tile of a triangle of tiles, enumerated by a single index
+//
+// A loop over the index (e.g. `#pragma omp for schedule(dynamic)`) visits only the tiles
+// of the triangle, unlike a collapsed loop over the whole square that skips the others.
+struct triangle_tile {
+	std::size_t row;
+	std::size_t col;
+};
+
+// the number of tiles of a lower triangle with the given number of rows (the diagonal included)
+constexpr std::size_t triangle_tiles(std::size_t rows) {
+	return rows * (rows + 1) / 2;
+}
+
+// the t-th tile of a lower triangle (col <= row), row by row: (0, 0), (1, 0), (1, 1), (2, 0), ...
+inline triangle_tile lower_triangle_tile(std::size_t t) {
+	std::size_t row = (std::size_t)((std::sqrt(8.0 * t + 1) - 1) / 2);
+
+	// the rounding of the square root may be off by one
+	while (triangle_tiles(row) > t)
+		--row;
+
+	while (triangle_tiles(row + 1) <= t)
+		++row;
+
+	return {row, t - triangle_tiles(row)};
+}
+
+} // namespace polybench
+
+#endif // NOARR_POLYBENCH_TRIANGLE_HPP
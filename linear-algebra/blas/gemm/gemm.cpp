@@ -1,10 +1,15 @@
-#include <chrono>
+#include <algorithm>
 #include <iomanip>
 #include <iostream>
 
 #include <noarr/traversers.hpp>
 
 #include "defines.hpp"
+#include "params.hpp"
+#include "harness.hpp"
+#include "affinity.hpp"
+#include "memory.hpp"
+#include "results.hpp"
 #include "gemm.hpp"
 
 using num_t = DATA_TYPE;
@@ -16,11 +21,25 @@ constexpr auto j_vec = noarr::vector<'j'>();
 constexpr auto k_vec = noarr::vector<'k'>();
 
 struct tuning {
+#ifdef TUNING_HEADER
+# include TUNING_HEADER
+#else
 	DEFINE_PROTO_STRUCT(c_layout, j_vec ^ i_vec);
 	DEFINE_PROTO_STRUCT(a_layout, k_vec ^ i_vec);
 	DEFINE_PROTO_STRUCT(b_layout, j_vec ^ k_vec);
+
+	// kernel_gemm_blocked: block_j-wide panels of C, k-blocks of A and B packed into micro-panels shared by the threads
+	AUTO_FIELD(blocked, false);
+	AUTO_FIELD(block_i, (std::size_t)96);
+	AUTO_FIELD(block_j, (std::size_t)256);
+	AUTO_FIELD(block_k, (std::size_t)256);
+#endif
 } tuning;
 
+// register tile of the micro-kernel of kernel_gemm_blocked
+constexpr std::size_t micro_i = 4;
+constexpr std::size_t micro_j = 16;
+
 // initialization function
 void init_array(num_t &alpha, num_t &beta, auto C, auto A, auto B) {
 	// C: i x j
@@ -68,15 +87,156 @@ void kernel_gemm(num_t alpha, num_t beta, auto C, auto A, auto B) {
 	#pragma endscop
 }
 
+// the micro-kernel of kernel_gemm_blocked: C[i0 + r, j0 + c] += the A panel ip times the B panel jp
+// (for r < rows and c < cols; the panels are padded with zeros to the whole register tile)
+[[gnu::always_inline]]
+inline void gemm_micro_kernel(auto C, auto A_pack, auto B_pack,
+	std::size_t i0, std::size_t j0, std::size_t ip, std::size_t jp,
+	std::size_t rows, std::size_t cols, std::size_t depth) {
+	// C: i x j
+	// A_pack: p x k x r
+	// B_pack: p x k x c
+	using namespace noarr;
+
+	num_t acc[micro_i][micro_j] = {};
+
+	for (std::size_t r = 0; r < rows; ++r)
+		for (std::size_t c = 0; c < cols; ++c)
+			acc[r][c] = C[idx<'i'>(i0 + r) & idx<'j'>(j0 + c)];
+
+	// both panels are read contiguously: micro_i values of A and micro_j values of B per k
+	for (std::size_t k = 0; k < depth; ++k) {
+		for (std::size_t r = 0; r < micro_i; ++r) {
+			const num_t a = A_pack[idx<'p'>(ip) & idx<'k'>(k) & idx<'r'>(r)];
+
+			#pragma omp simd
+			for (std::size_t c = 0; c < micro_j; ++c)
+				acc[r][c] += a * B_pack[idx<'p'>(jp) & idx<'k'>(k) & idx<'c'>(c)];
+		}
+	}
+
+	for (std::size_t r = 0; r < rows; ++r)
+		for (std::size_t c = 0; c < cols; ++c)
+			C[idx<'i'>(i0 + r) & idx<'j'>(j0 + c)] = acc[r][c];
+}
+
+// blocked multi-threaded computation kernel
+//
+// As in GotoBLAS: for each block_j-wide panel of C and each k-block, the threads
+// pack the k-block of B into micro_j-wide column panels and the k-block of A
+// (times alpha) into micro_i-wide row panels, both shared; then they compute the
+// block_i x micro_j tiles of C, reusing each packed A block over the B panels.
+// Every C element still accumulates its k-terms in the original order.
+[[gnu::flatten, gnu::noinline]]
+void kernel_gemm_blocked(num_t alpha, num_t beta, auto C, auto A, auto B,
+	std::size_t block_i, std::size_t block_j, std::size_t block_k) {
+	// C: i x j
+	// A: i x k
+	// B: k x j
+	using namespace noarr;
+
+	const std::size_t ni = C | get_length<'i'>();
+	const std::size_t nj = C | get_length<'j'>();
+	const std::size_t nk = A | get_length<'k'>();
+
+	// the micro-panels of all of A, of a panel of B, and of a block of A (rounded up to whole register tiles)
+	const std::size_t panels_a = (ni + micro_i - 1) / micro_i;
+	const std::size_t panels_b = (block_j + micro_j - 1) / micro_j;
+	const std::size_t panels_block = (block_i + micro_i - 1) / micro_i;
+
+	const std::size_t blocks_i = (panels_a + panels_block - 1) / panels_block;
+
+	// A_pack: p x k x r (a k-block of alpha * A), B_pack: p x k x c (a k-block of a panel of B)
+	auto A_pack_bag = make_bag(scalar<num_t>() ^ vector<'r'>(micro_i) ^ vector<'k'>(block_k) ^ vector<'p'>(panels_a));
+	auto B_pack_bag = make_bag(scalar<num_t>() ^ vector<'c'>(micro_j) ^ vector<'k'>(block_k) ^ vector<'p'>(panels_b));
+
+	auto A_pack = A_pack_bag.get_ref();
+	auto B_pack = B_pack_bag.get_ref();
+
+	#pragma omp parallel
+	{
+		#pragma omp for schedule(static)
+		for (std::size_t i = 0; i < ni; ++i)
+			for (std::size_t j = 0; j < nj; ++j)
+				C[idx<'i'>(i) & idx<'j'>(j)] *= beta;
+
+		for (std::size_t j0 = 0; j0 < nj; j0 += block_j) {
+			const std::size_t j1 = std::min(j0 + block_j, nj);
+			const std::size_t panels_j = (j1 - j0 + micro_j - 1) / micro_j;
+
+			for (std::size_t k0 = 0; k0 < nk; k0 += block_k) {
+				const std::size_t k1 = std::min(k0 + block_k, nk);
+
+				// the implicit barriers publish the packed panels to all the threads
+				#pragma omp for schedule(static) nowait
+				for (std::size_t p = 0; p < panels_j; ++p) {
+					for (std::size_t k = k0; k < k1; ++k) {
+						for (std::size_t c = 0; c < micro_j; ++c) {
+							const std::size_t j = j0 + p * micro_j + c;
+							B_pack[idx<'p'>(p) & idx<'k'>(k - k0) & idx<'c'>(c)] = j < j1 ? B[idx<'k'>(k) & idx<'j'>(j)] : 0;
+						}
+					}
+				}
+
+				#pragma omp for schedule(static)
+				for (std::size_t p = 0; p < panels_a; ++p) {
+					for (std::size_t k = k0; k < k1; ++k) {
+						for (std::size_t r = 0; r < micro_i; ++r) {
+							const std::size_t i = p * micro_i + r;
+							A_pack[idx<'p'>(p) & idx<'k'>(k - k0) & idx<'r'>(r)] = i < ni ? alpha * A[idx<'i'>(i) & idx<'k'>(k)] : 0;
+						}
+					}
+				}
+
+				// a thread keeps its block of A (in the cache) over consecutive B panels
+				#pragma omp for collapse(2) schedule(static)
+				for (std::size_t bi = 0; bi < blocks_i; ++bi) {
+					for (std::size_t jp = 0; jp < panels_j; ++jp) {
+						const std::size_t j = j0 + jp * micro_j;
+						const std::size_t p1 = std::min((bi + 1) * panels_block, panels_a);
+
+						for (std::size_t ip = bi * panels_block; ip < p1; ++ip) {
+							const std::size_t i = ip * micro_i;
+
+							gemm_micro_kernel(C, A_pack, B_pack, i, j, ip, jp,
+								std::min(micro_i, ni - i), std::min(micro_j, j1 - j), k1 - k0);
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+// floating-point operations of kernel_gemm
+constexpr double flop_count(std::size_t ni, std::size_t nj, std::size_t nk) {
+	return 2.0 * ni * nj * nk + 1.0 * ni * nj;
+}
+
+// compulsory memory traffic of kernel_gemm in bytes (inputs read and outputs written once)
+constexpr double byte_count(std::size_t ni, std::size_t nj, std::size_t nk) {
+	return sizeof(num_t) * (2.0 * ni * nj + 1.0 * ni * nk + 1.0 * nk * nj);
+}
+
 } // namespace
 
-int main(int argc, char *argv[]) {
+int KERNEL_MAIN(int argc, char *argv[]) {
 	using namespace std::string_literals;
 
+	// benchmark parameters
+	polybench::params params(argc, argv);
+
+	// the sizes of the selected variant
+	if (tuning.blocked) {
+		polybench::require_tuning_size("block_i", tuning.block_i);
+		polybench::require_tuning_size("block_j", tuning.block_j);
+		polybench::require_tuning_size("block_k", tuning.block_k);
+	}
+
 	// problem size
-	std::size_t ni = NI;
-	std::size_t nj = NJ;
-	std::size_t nk = NK;
+	std::size_t ni = params.size("NI", NI);
+	std::size_t nj = params.size("NJ", NJ);
+	std::size_t nk = params.size("NK", NK);
 
 	// input data
 	num_t alpha;
@@ -84,28 +244,61 @@ int main(int argc, char *argv[]) {
 
 	auto set_lengths = noarr::set_length<'i'>(ni) ^ noarr::set_length<'j'>(nj) ^ noarr::set_length<'k'>(nk);
 
-	auto C = noarr::make_bag(noarr::scalar<num_t>() ^ tuning.c_layout ^ set_lengths);
-	auto A = noarr::make_bag(noarr::scalar<num_t>() ^ tuning.a_layout ^ set_lengths);
-	auto B = noarr::make_bag(noarr::scalar<num_t>() ^ tuning.b_layout ^ set_lengths);
-
-	// initialize data
-	init_array(alpha, beta, C.get_ref(), A.get_ref(), B.get_ref());
+	polybench::affinity affinity(params);
+	polybench::memory memory(params);
 
-	auto start = std::chrono::high_resolution_clock::now();
+	// partitioned as by kernel_gemm_blocked: the blocks of C (block_i rounded up to whole micro-panels),
+	// the micro-panels of A and B it packs (of B within each panel of block_j columns, the first one matched)
+	auto C = memory.make_bag(noarr::scalar<num_t>() ^ tuning.c_layout ^ set_lengths,
+		polybench::partition<'i'>{(tuning.block_i + micro_i - 1) / micro_i * micro_i});
+	auto A = memory.make_bag(noarr::scalar<num_t>() ^ tuning.a_layout ^ set_lengths, polybench::partition<'i'>{micro_i});
+	auto B = memory.make_bag(noarr::scalar<num_t>() ^ tuning.b_layout ^ set_lengths, polybench::partition<'j'>{micro_j});
 
-	// run kernel
-	kernel_gemm(alpha, beta, C.get_ref(), A.get_ref(), B.get_ref());
+	polybench::harness harness("gemm", params);
 
-	auto end = std::chrono::high_resolution_clock::now();
+	harness
+		.length("ni", ni)
+		.length("nj", nj)
+		.length("nk", nk)
+		.tuning("c_layout", tuning.c_layout)
+		.tuning("a_layout", tuning.a_layout)
+		.tuning("b_layout", tuning.b_layout)
+		.tuning("blocked", tuning.blocked)
+		.tuning("block_i", tuning.block_i)
+		.tuning("block_j", tuning.block_j)
+		.tuning("block_k", tuning.block_k)
+		.environment(affinity.settings())
+		.environment(memory.settings())
+		.flops(flop_count(ni, nj, nk))
+		.bytes(byte_count(ni, nj, nk));
 
-	auto duration = std::chrono::duration<long double>(end - start);
+	harness.run([&] {
+		// initialize data
+		init_array(alpha, beta, C.get_ref(), A.get_ref(), B.get_ref());
+	}, [&] {
+		// run kernel
+		if (tuning.blocked)
+			kernel_gemm_blocked(alpha, beta, C.get_ref(), A.get_ref(), B.get_ref(), tuning.block_i, tuning.block_j, tuning.block_k);
+		else
+			kernel_gemm(alpha, beta, C.get_ref(), A.get_ref(), B.get_ref());
+	});
 
 	// print results
+	polybench::results results(params);
+
 	if (argc > 0 && argv[0] != ""s) {
-		std::cout << std::fixed << std::setprecision(2);
-		noarr::serialize_data(std::cout, C.get_ref() ^ noarr::hoist<'i'>());
+		if (results.text()) {
+			std::cout << std::fixed << std::setprecision(2);
+			noarr::serialize_data(std::cout, C.get_ref() ^ noarr::hoist<'i'>());
+		}
+		else {
+			results.write<'i', 'j'>("C", C.get_ref());
+		}
 	}
 
-	std::cerr << std::fixed << std::setprecision(6);
-	std::cerr << duration.count() << std::endl;
+	harness.environment(memory.placement());
+	harness.report(std::cerr);
+	memory.report(std::cerr);
+
+	return 0;
 }
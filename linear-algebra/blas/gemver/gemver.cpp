@@ -1,10 +1,14 @@
-#include <chrono>
 #include <iomanip>
 #include <iostream>
 
 #include <noarr/traversers.hpp>
 
 #include "defines.hpp"
+#include "params.hpp"
+#include "harness.hpp"
+#include "affinity.hpp"
+#include "memory.hpp"
+#include "results.hpp"
 #include "gemver.hpp"
 
 using num_t = DATA_TYPE;
@@ -15,6 +19,9 @@ constexpr auto i_vec = noarr::vector<'i'>();
 constexpr auto j_vec = noarr::vector<'j'>();
 
 struct tuning {
+#ifdef TUNING_HEADER
+# include TUNING_HEADER
+#else
 	DEFINE_PROTO_STRUCT(block_i1, noarr::hoist<'i'>());
 	DEFINE_PROTO_STRUCT(block_j1, noarr::hoist<'j'>());
 
@@ -31,6 +38,7 @@ struct tuning {
 	DEFINE_PROTO_STRUCT(order3, block_j3 ^ block_i3);
 
 	DEFINE_PROTO_STRUCT(a_layout, j_vec ^ i_vec);
+#endif
 } tuning;
 
 // initialization function
@@ -115,53 +123,94 @@ void kernel_gemver(num_t alpha, num_t beta, auto A,
 	#pragma endscop
 }
 
+// floating-point operations of kernel_gemver
+constexpr double flop_count(std::size_t n) {
+	return 8.0 * n * n + 5.0 * n;
+}
+
+// compulsory memory traffic of kernel_gemver in bytes (inputs read and outputs written once)
+constexpr double byte_count(std::size_t n) {
+	return sizeof(num_t) * (2.0 * n * n + 10.0 * n);
+}
+
 } // namespace
 
-int main(int argc, char *argv[]) {
+int KERNEL_MAIN(int argc, char *argv[]) {
 	using namespace std::string_literals;
 
+	// benchmark parameters
+	polybench::params params(argc, argv);
+
 	// problem size
-	std::size_t n = N;
+	std::size_t n = params.size("N", N);
 
 	// data
 	num_t alpha;
 	num_t beta;
 
-	auto A = noarr::make_bag(noarr::scalar<num_t>() ^ tuning.a_layout ^ noarr::set_length<'i'>(n) ^ noarr::set_length<'j'>(n));
-	auto u1 = noarr::make_bag(noarr::scalar<num_t>() ^ noarr::vector<'i'>(n));
-	auto v1 = noarr::make_bag(noarr::scalar<num_t>() ^ noarr::vector<'j'>(n));
-	auto u2 = noarr::make_bag(noarr::scalar<num_t>() ^ noarr::vector<'i'>(n));
-	auto v2 = noarr::make_bag(noarr::scalar<num_t>() ^ noarr::vector<'j'>(n));
-	auto w = noarr::make_bag(noarr::scalar<num_t>() ^ noarr::vector<'i'>(n));
-	auto x = noarr::make_bag(noarr::scalar<num_t>() ^ noarr::vector<'i'>(n));
-	auto y = noarr::make_bag(noarr::scalar<num_t>() ^ noarr::vector<'j'>(n));
-	auto z = noarr::make_bag(noarr::scalar<num_t>() ^ noarr::vector<'i'>(n));
-
-	// initialize data
-	init_array(alpha, beta, A.get_ref(),
-		u1.get_ref(), v1.get_ref(),
-		u2.get_ref(), v2.get_ref(),
-		w.get_ref(), x.get_ref(), y.get_ref(), z.get_ref());
-
-	auto start = std::chrono::high_resolution_clock::now();
-
-	// run kernel
-	kernel_gemver(alpha, beta, A.get_ref(),
-		u1.get_ref(), v1.get_ref(),
-		u2.get_ref(), v2.get_ref(),
-		w.get_ref(), x.get_ref(), y.get_ref(), z.get_ref(),
-		tuning.order1, tuning.order2, tuning.order3);
-
-	auto end = std::chrono::high_resolution_clock::now();
-
-	auto duration = std::chrono::duration<long double>(end - start);
+	polybench::affinity affinity(params);
+	polybench::memory memory(params);
+
+	auto A = memory.make_bag(noarr::scalar<num_t>() ^ tuning.a_layout ^ noarr::set_length<'i'>(n) ^ noarr::set_length<'j'>(n));
+	auto u1 = memory.make_bag(noarr::scalar<num_t>() ^ noarr::vector<'i'>(n));
+	auto v1 = memory.make_bag(noarr::scalar<num_t>() ^ noarr::vector<'j'>(n));
+	auto u2 = memory.make_bag(noarr::scalar<num_t>() ^ noarr::vector<'i'>(n));
+	auto v2 = memory.make_bag(noarr::scalar<num_t>() ^ noarr::vector<'j'>(n));
+	auto w = memory.make_bag(noarr::scalar<num_t>() ^ noarr::vector<'i'>(n));
+	auto x = memory.make_bag(noarr::scalar<num_t>() ^ noarr::vector<'i'>(n));
+	auto y = memory.make_bag(noarr::scalar<num_t>() ^ noarr::vector<'j'>(n));
+	auto z = memory.make_bag(noarr::scalar<num_t>() ^ noarr::vector<'i'>(n));
+
+	polybench::harness harness("gemver", params);
+
+	harness
+		.length("n", n)
+		.tuning("block_i1", tuning.block_i1)
+		.tuning("block_j1", tuning.block_j1)
+		.tuning("order1", tuning.order1)
+		.tuning("block_i2", tuning.block_i2)
+		.tuning("block_j2", tuning.block_j2)
+		.tuning("order2", tuning.order2)
+		.tuning("block_i3", tuning.block_i3)
+		.tuning("block_j3", tuning.block_j3)
+		.tuning("order3", tuning.order3)
+		.tuning("a_layout", tuning.a_layout)
+		.environment(affinity.settings())
+		.environment(memory.settings())
+		.flops(flop_count(n))
+		.bytes(byte_count(n));
+
+	harness.run([&] {
+		// initialize data
+		init_array(alpha, beta, A.get_ref(),
+			u1.get_ref(), v1.get_ref(),
+			u2.get_ref(), v2.get_ref(),
+			w.get_ref(), x.get_ref(), y.get_ref(), z.get_ref());
+	}, [&] {
+		// run kernel
+		kernel_gemver(alpha, beta, A.get_ref(),
+			u1.get_ref(), v1.get_ref(),
+			u2.get_ref(), v2.get_ref(),
+			w.get_ref(), x.get_ref(), y.get_ref(), z.get_ref(),
+			tuning.order1, tuning.order2, tuning.order3);
+	});
 
 	// print results
+	polybench::results results(params);
+
 	if (argc > 0 && argv[0] != ""s) {
-		std::cout << std::fixed << std::setprecision(2);
-		noarr::serialize_data(std::cout, w);
+		if (results.text()) {
+			std::cout << std::fixed << std::setprecision(2);
+			noarr::serialize_data(std::cout, w);
+		}
+		else {
+			results.write<'i'>("w", w.get_ref());
+		}
 	}
 
-	std::cerr << std::fixed << std::setprecision(6);
-	std::cerr << duration.count() << std::endl;
+	harness.environment(memory.placement());
+	harness.report(std::cerr);
+	memory.report(std::cerr);
+
+	return 0;
 }
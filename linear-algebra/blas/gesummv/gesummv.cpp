@@ -1,10 +1,14 @@
-#include <chrono>
 #include <iomanip>
 #include <iostream>
 
 #include <noarr/traversers.hpp>
 
 #include "defines.hpp"
+#include "params.hpp"
+#include "harness.hpp"
+#include "affinity.hpp"
+#include "memory.hpp"
+#include "results.hpp"
 #include "gesummv.hpp"
 
 using num_t = DATA_TYPE;
@@ -15,8 +19,12 @@ constexpr auto i_vec = noarr::vector<'i'>();
 constexpr auto j_vec = noarr::vector<'j'>();
 
 struct tuning {
+#ifdef TUNING_HEADER
+# include TUNING_HEADER
+#else
 	DEFINE_PROTO_STRUCT(a_layout, j_vec ^ i_vec);
 	DEFINE_PROTO_STRUCT(b_layout, j_vec ^ i_vec);
+#endif
 } tuning;
 
 // initialization function
@@ -70,43 +78,76 @@ void kernel_gesummv(num_t alpha, num_t beta, auto A, auto B, auto tmp, auto x, a
 	#pragma endscop
 }
 
+// floating-point operations of kernel_gesummv
+constexpr double flop_count(std::size_t n) {
+	return 4.0 * n * n + 3.0 * n;
+}
+
+// compulsory memory traffic of kernel_gesummv in bytes (inputs read and outputs written once)
+constexpr double byte_count(std::size_t n) {
+	return sizeof(num_t) * (2.0 * n * n + 3.0 * n);
+}
+
 } // namespace
 
-int main(int argc, char *argv[]) {
+int KERNEL_MAIN(int argc, char *argv[]) {
 	using namespace std::string_literals;
 
+	// benchmark parameters
+	polybench::params params(argc, argv);
+
 	// problem size
-	std::size_t n = N;
+	std::size_t n = params.size("N", N);
 
 	// data
 	num_t alpha;
 	num_t beta;
 
-	auto A = noarr::make_bag(noarr::scalar<num_t>() ^ tuning.a_layout ^ noarr::set_length<'i'>(n) ^ noarr::set_length<'j'>(n));
-	auto B = noarr::make_bag(noarr::scalar<num_t>() ^ tuning.b_layout ^ noarr::set_length<'i'>(n) ^ noarr::set_length<'j'>(n));
-	auto tmp = noarr::make_bag(noarr::scalar<num_t>() ^ noarr::vector<'i'>(n));
-	auto x = noarr::make_bag(noarr::scalar<num_t>() ^ noarr::vector<'j'>(n));
-	auto y = noarr::make_bag(noarr::scalar<num_t>() ^ noarr::vector<'i'>(n));
-
-	// initialize data
-	init_array(alpha, beta, A.get_ref(), B.get_ref(), x.get_ref());
-
-
-	auto start = std::chrono::high_resolution_clock::now();
-
-	// run kernel
-	kernel_gesummv(alpha, beta, A.get_ref(), B.get_ref(), tmp.get_ref(), x.get_ref(), y.get_ref());
-
-	auto end = std::chrono::high_resolution_clock::now();
-
-	auto duration = std::chrono::duration<long double>(end - start);
+	polybench::affinity affinity(params);
+	polybench::memory memory(params);
+
+	auto A = memory.make_bag(noarr::scalar<num_t>() ^ tuning.a_layout ^ noarr::set_length<'i'>(n) ^ noarr::set_length<'j'>(n));
+	auto B = memory.make_bag(noarr::scalar<num_t>() ^ tuning.b_layout ^ noarr::set_length<'i'>(n) ^ noarr::set_length<'j'>(n));
+	auto tmp = memory.make_bag(noarr::scalar<num_t>() ^ noarr::vector<'i'>(n));
+	auto x = memory.make_bag(noarr::scalar<num_t>() ^ noarr::vector<'j'>(n));
+	auto y = memory.make_bag(noarr::scalar<num_t>() ^ noarr::vector<'i'>(n));
+
+	polybench::harness harness("gesummv", params);
+
+	harness
+		.length("n", n)
+		.tuning("a_layout", tuning.a_layout)
+		.tuning("b_layout", tuning.b_layout)
+		.environment(affinity.settings())
+		.environment(memory.settings())
+		.flops(flop_count(n))
+		.bytes(byte_count(n));
+
+	harness.run([&] {
+		// initialize data
+		init_array(alpha, beta, A.get_ref(), B.get_ref(), x.get_ref());
+
+	}, [&] {
+		// run kernel
+		kernel_gesummv(alpha, beta, A.get_ref(), B.get_ref(), tmp.get_ref(), x.get_ref(), y.get_ref());
+	});
 
 	// print results
+	polybench::results results(params);
+
 	if (argc > 0 && argv[0] != ""s) {
-		std::cout << std::fixed << std::setprecision(2);
-		noarr::serialize_data(std::cout, y);
+		if (results.text()) {
+			std::cout << std::fixed << std::setprecision(2);
+			noarr::serialize_data(std::cout, y);
+		}
+		else {
+			results.write<'i'>("y", y.get_ref());
+		}
 	}
 
-	std::cerr << std::fixed << std::setprecision(6);
-	std::cerr << duration.count() << std::endl;
+	harness.environment(memory.placement());
+	harness.report(std::cerr);
+	memory.report(std::cerr);
+
+	return 0;
 }
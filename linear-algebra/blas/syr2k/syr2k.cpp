@@ -1,10 +1,14 @@
-#include <chrono>
 #include <iomanip>
 #include <iostream>
 
 #include <noarr/traversers.hpp>
 
 #include "defines.hpp"
+#include "params.hpp"
+#include "harness.hpp"
+#include "affinity.hpp"
+#include "memory.hpp"
+#include "results.hpp"
 #include "syr2k.hpp"
 
 using num_t = DATA_TYPE;
@@ -16,11 +20,15 @@ constexpr auto j_vec = noarr::vector<'j'>();
 constexpr auto k_vec = noarr::vector<'k'>();
 
 struct tuning {
+#ifdef TUNING_HEADER
+# include TUNING_HEADER
+#else
 	DEFINE_PROTO_STRUCT(order, noarr::hoist<'k'>());
 
 	DEFINE_PROTO_STRUCT(c_layout, j_vec ^ i_vec);
 	DEFINE_PROTO_STRUCT(a_layout, k_vec ^ i_vec);
 	DEFINE_PROTO_STRUCT(b_layout, k_vec ^ i_vec);
+#endif
 } tuning;
 
 // initialization function
@@ -75,14 +83,27 @@ void kernel_syr2k(num_t alpha, num_t beta, auto C, auto A, auto B, Order order =
 	#pragma endscop
 }
 
+// floating-point operations of kernel_syr2k
+constexpr double flop_count(std::size_t ni, std::size_t nk) {
+	return 2.0 * ni * (ni + 1.0) * nk + ni * (ni + 1.0) / 2;
+}
+
+// compulsory memory traffic of kernel_syr2k in bytes (inputs read and outputs written once)
+constexpr double byte_count(std::size_t ni, std::size_t nk) {
+	return sizeof(num_t) * (2.0 * ni * ni + 2.0 * ni * nk);
+}
+
 } // namespace
 
-int main(int argc, char *argv[]) {
+int KERNEL_MAIN(int argc, char *argv[]) {
 	using namespace std::string_literals;
 
+	// benchmark parameters
+	polybench::params params(argc, argv);
+
 	// problem size
-	std::size_t ni = NI;
-	std::size_t nk = NK;
+	std::size_t ni = params.size("NI", NI);
+	std::size_t nk = params.size("NK", NK);
 
 	// data
 	num_t alpha;
@@ -90,28 +111,51 @@ int main(int argc, char *argv[]) {
 
 	auto set_lengths = noarr::set_length<'i'>(ni) ^ noarr::set_length<'k'>(nk) ^ noarr::set_length<'j'>(ni);
 
-	auto C = noarr::make_bag(noarr::scalar<num_t>() ^ tuning.c_layout ^ set_lengths);
-	auto A = noarr::make_bag(noarr::scalar<num_t>() ^ tuning.a_layout ^ set_lengths);
-	auto B = noarr::make_bag(noarr::scalar<num_t>() ^ tuning.b_layout ^ set_lengths);
-
-	// initialize data
-	init_array(alpha, beta, C.get_ref(), A.get_ref(), B.get_ref());
-
-	auto start = std::chrono::high_resolution_clock::now();
-
-	// run kernel
-	kernel_syr2k(alpha, beta, C.get_ref(), A.get_ref(), B.get_ref(), tuning.order);
-
-	auto end = std::chrono::high_resolution_clock::now();
-
-	auto duration = std::chrono::duration<long double>(end - start);
+	polybench::affinity affinity(params);
+	polybench::memory memory(params);
+
+	auto C = memory.make_bag(noarr::scalar<num_t>() ^ tuning.c_layout ^ set_lengths);
+	auto A = memory.make_bag(noarr::scalar<num_t>() ^ tuning.a_layout ^ set_lengths);
+	auto B = memory.make_bag(noarr::scalar<num_t>() ^ tuning.b_layout ^ set_lengths);
+
+	polybench::harness harness("syr2k", params);
+
+	harness
+		.length("ni", ni)
+		.length("nk", nk)
+		.tuning("order", tuning.order)
+		.tuning("c_layout", tuning.c_layout)
+		.tuning("a_layout", tuning.a_layout)
+		.tuning("b_layout", tuning.b_layout)
+		.environment(affinity.settings())
+		.environment(memory.settings())
+		.flops(flop_count(ni, nk))
+		.bytes(byte_count(ni, nk));
+
+	harness.run([&] {
+		// initialize data
+		init_array(alpha, beta, C.get_ref(), A.get_ref(), B.get_ref());
+	}, [&] {
+		// run kernel
+		kernel_syr2k(alpha, beta, C.get_ref(), A.get_ref(), B.get_ref(), tuning.order);
+	});
 
 	// print results
+	polybench::results results(params);
+
 	if (argc > 0 && argv[0] != ""s) {
-		std::cout << std::fixed << std::setprecision(2);
-		noarr::serialize_data(std::cout, C.get_ref() ^ noarr::hoist<'i'>());
+		if (results.text()) {
+			std::cout << std::fixed << std::setprecision(2);
+			noarr::serialize_data(std::cout, C.get_ref() ^ noarr::hoist<'i'>());
+		}
+		else {
+			results.write<'i', 'j'>("C", C.get_ref());
+		}
 	}
 
-	std::cerr << std::fixed << std::setprecision(6);
-	std::cerr << duration.count() << std::endl;
+	harness.environment(memory.placement());
+	harness.report(std::cerr);
+	memory.report(std::cerr);
+
+	return 0;
 }
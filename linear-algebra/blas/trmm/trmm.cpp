@@ -1,10 +1,14 @@
-#include <chrono>
 #include <iomanip>
 #include <iostream>
 
 #include <noarr/traversers.hpp>
 
 #include "defines.hpp"
+#include "params.hpp"
+#include "harness.hpp"
+#include "affinity.hpp"
+#include "memory.hpp"
+#include "results.hpp"
 #include "trmm.hpp"
 
 using num_t = DATA_TYPE;
@@ -16,6 +20,9 @@ constexpr auto j_vec = noarr::vector<'j'>();
 constexpr auto k_vec = noarr::vector<'k'>();
 
 struct tuning {
+#ifdef TUNING_HEADER
+# include TUNING_HEADER
+#else
 	DEFINE_PROTO_STRUCT(block_i, noarr::hoist<'i'>());
 	DEFINE_PROTO_STRUCT(block_j, noarr::hoist<'j'>());
 
@@ -23,6 +30,7 @@ struct tuning {
 
 	DEFINE_PROTO_STRUCT(a_layout, i_vec ^ k_vec);
 	DEFINE_PROTO_STRUCT(b_layout, j_vec ^ i_vec);
+#endif
 } tuning;
 
 // initialization function
@@ -75,41 +83,78 @@ void kernel_trmm(num_t alpha, auto A, auto B, Order order = {}) {
 	#pragma endscop
 }
 
+// floating-point operations of kernel_trmm
+constexpr double flop_count(std::size_t ni, std::size_t nj) {
+	return ni * (ni - 1.0) * nj + 1.0 * ni * nj;
+}
+
+// compulsory memory traffic of kernel_trmm in bytes (inputs read and outputs written once)
+constexpr double byte_count(std::size_t ni, std::size_t nj) {
+	return sizeof(num_t) * (1.0 * ni * ni + 2.0 * ni * nj);
+}
+
 } // namespace
 
-int main(int argc, char *argv[]) {
+int KERNEL_MAIN(int argc, char *argv[]) {
 	using namespace std::string_literals;
 
+	// benchmark parameters
+	polybench::params params(argc, argv);
+
 	// problem size
-	std::size_t ni = NI;
-	std::size_t nj = NJ;
+	std::size_t ni = params.size("NI", NI);
+	std::size_t nj = params.size("NJ", NJ);
 
 	// data
 	num_t alpha;
 
 	auto set_lengths = noarr::set_length<'i'>(ni) ^ noarr::set_length<'k'>(ni) ^ noarr::set_length<'j'>(nj);
 
-	auto A = noarr::make_bag(noarr::scalar<num_t>() ^ tuning.a_layout ^ set_lengths);
-	auto B = noarr::make_bag(noarr::scalar<num_t>() ^ tuning.b_layout ^ set_lengths);
-
-	// initialize data
-	init_array(alpha, A.get_ref(), B.get_ref());
-
-	auto start = std::chrono::high_resolution_clock::now();
-
-	// run kernel
-	kernel_trmm(alpha, A.get_ref(), B.get_ref(), tuning.order);
-
-	auto end = std::chrono::high_resolution_clock::now();
-
-	auto duration = std::chrono::duration<long double>(end - start);
+	polybench::affinity affinity(params);
+	polybench::memory memory(params);
+
+	auto A = memory.make_bag(noarr::scalar<num_t>() ^ tuning.a_layout ^ set_lengths);
+	auto B = memory.make_bag(noarr::scalar<num_t>() ^ tuning.b_layout ^ set_lengths);
+
+	polybench::harness harness("trmm", params);
+
+	harness
+		.length("ni", ni)
+		.length("nj", nj)
+		.tuning("block_i", tuning.block_i)
+		.tuning("block_j", tuning.block_j)
+		.tuning("order", tuning.order)
+		.tuning("a_layout", tuning.a_layout)
+		.tuning("b_layout", tuning.b_layout)
+		.environment(affinity.settings())
+		.environment(memory.settings())
+		.flops(flop_count(ni, nj))
+		.bytes(byte_count(ni, nj));
+
+	harness.run([&] {
+		// initialize data
+		init_array(alpha, A.get_ref(), B.get_ref());
+	}, [&] {
+		// run kernel
+		kernel_trmm(alpha, A.get_ref(), B.get_ref(), tuning.order);
+	});
 
 	// print results
+	polybench::results results(params);
+
 	if (argc > 0 && argv[0] != ""s) {
-		std::cout << std::fixed << std::setprecision(2);
-		noarr::serialize_data(std::cout, B.get_ref() ^ noarr::hoist<'i'>());
+		if (results.text()) {
+			std::cout << std::fixed << std::setprecision(2);
+			noarr::serialize_data(std::cout, B.get_ref() ^ noarr::hoist<'i'>());
+		}
+		else {
+			results.write<'i', 'j'>("B", B.get_ref());
+		}
 	}
 
-	std::cerr << std::fixed << std::setprecision(6);
-	std::cerr << duration.count() << std::endl;
+	harness.environment(memory.placement());
+	harness.report(std::cerr);
+	memory.report(std::cerr);
+
+	return 0;
 }
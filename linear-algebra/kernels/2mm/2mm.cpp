@@ -1,10 +1,14 @@
-#include <chrono>
 #include <iomanip>
 #include <iostream>
 
 #include <noarr/traversers.hpp>
 
 #include "defines.hpp"
+#include "params.hpp"
+#include "harness.hpp"
+#include "affinity.hpp"
+#include "memory.hpp"
+#include "results.hpp"
 #include "2mm.hpp"
 
 using num_t = DATA_TYPE;
@@ -17,6 +21,9 @@ constexpr auto k_vec = noarr::vector<'k'>();
 constexpr auto l_vec = noarr::vector<'l'>();
 
 struct tuning {
+#ifdef TUNING_HEADER
+# include TUNING_HEADER
+#else
 	DEFINE_PROTO_STRUCT(block_i1, noarr::hoist<'i'>());
 	DEFINE_PROTO_STRUCT(block_j1, noarr::hoist<'j'>());
 	DEFINE_PROTO_STRUCT(block_i2, noarr::hoist<'i'>());
@@ -30,6 +37,7 @@ struct tuning {
 	DEFINE_PROTO_STRUCT(b_layout, j_vec ^ k_vec);
 	DEFINE_PROTO_STRUCT(c_layout, l_vec ^ j_vec);
 	DEFINE_PROTO_STRUCT(d_layout, l_vec ^ i_vec);
+#endif
 } tuning;
 
 // initialization function
@@ -98,16 +106,29 @@ void kernel_2mm(num_t alpha, num_t beta, auto tmp, auto A, auto B, auto C, auto
 	#pragma endscop
 }
 
+// floating-point operations of kernel_2mm
+constexpr double flop_count(std::size_t ni, std::size_t nj, std::size_t nk, std::size_t nl) {
+	return 2.0 * ni * nj * nk + 2.0 * ni * nj * nl + 1.0 * ni * nl;
+}
+
+// compulsory memory traffic of kernel_2mm in bytes (inputs read and outputs written once)
+constexpr double byte_count(std::size_t ni, std::size_t nj, std::size_t nk, std::size_t nl) {
+	return sizeof(num_t) * (1.0 * ni * nk + 1.0 * nk * nj + 1.0 * nj * nl + 2.0 * ni * nl + 1.0 * ni * nj);
+}
+
 } // namespace
 
-int main(int argc, char *argv[]) {
+int KERNEL_MAIN(int argc, char *argv[]) {
 	using namespace std::string_literals;
 
+	// benchmark parameters
+	polybench::params params(argc, argv);
+
 	// problem size
-	std::size_t ni = NI;
-	std::size_t nj = NJ;
-	std::size_t nk = NK;
-	std::size_t nl = NL;
+	std::size_t ni = params.size("NI", NI);
+	std::size_t nj = params.size("NJ", NJ);
+	std::size_t nk = params.size("NK", NK);
+	std::size_t nl = params.size("NL", NL);
 
 	// data
 	num_t alpha;
@@ -115,32 +136,64 @@ int main(int argc, char *argv[]) {
 
 	auto set_lengths = noarr::set_length<'i'>(ni) ^ noarr::set_length<'j'>(nj) ^ noarr::set_length<'k'>(nk) ^ noarr::set_length<'l'>(nl);
 
-	auto tmp = noarr::make_bag(noarr::scalar<num_t>() ^ tuning.tmp_layout ^ set_lengths);
-
-	auto A = noarr::make_bag(noarr::scalar<num_t>() ^ tuning.a_layout ^ set_lengths);
-	auto B = noarr::make_bag(noarr::scalar<num_t>() ^ tuning.b_layout ^ set_lengths);
-	auto C = noarr::make_bag(noarr::scalar<num_t>() ^ tuning.c_layout ^ set_lengths);
-
-	auto D = noarr::make_bag(noarr::scalar<num_t>() ^ tuning.d_layout ^ set_lengths);
-
-	// initialize data
-	init_array(alpha, beta, A.get_ref(), B.get_ref(), C.get_ref(), D.get_ref());
-
-	auto start = std::chrono::high_resolution_clock::now();
-
-	// run kernel
-	kernel_2mm(alpha, beta, tmp.get_ref(), A.get_ref(), B.get_ref(), C.get_ref(), D.get_ref(), tuning.order1, tuning.order2);
-
-	auto end = std::chrono::high_resolution_clock::now();
-
-	auto duration = std::chrono::duration<long double>(end - start);
+	polybench::affinity affinity(params);
+	polybench::memory memory(params);
+
+	auto tmp = memory.make_bag(noarr::scalar<num_t>() ^ tuning.tmp_layout ^ set_lengths);
+
+	auto A = memory.make_bag(noarr::scalar<num_t>() ^ tuning.a_layout ^ set_lengths);
+	auto B = memory.make_bag(noarr::scalar<num_t>() ^ tuning.b_layout ^ set_lengths);
+	auto C = memory.make_bag(noarr::scalar<num_t>() ^ tuning.c_layout ^ set_lengths);
+
+	auto D = memory.make_bag(noarr::scalar<num_t>() ^ tuning.d_layout ^ set_lengths);
+
+	polybench::harness harness("2mm", params);
+
+	harness
+		.length("ni", ni)
+		.length("nj", nj)
+		.length("nk", nk)
+		.length("nl", nl)
+		.tuning("block_i1", tuning.block_i1)
+		.tuning("block_j1", tuning.block_j1)
+		.tuning("block_i2", tuning.block_i2)
+		.tuning("block_l2", tuning.block_l2)
+		.tuning("order1", tuning.order1)
+		.tuning("order2", tuning.order2)
+		.tuning("tmp_layout", tuning.tmp_layout)
+		.tuning("a_layout", tuning.a_layout)
+		.tuning("b_layout", tuning.b_layout)
+		.tuning("c_layout", tuning.c_layout)
+		.tuning("d_layout", tuning.d_layout)
+		.environment(affinity.settings())
+		.environment(memory.settings())
+		.flops(flop_count(ni, nj, nk, nl))
+		.bytes(byte_count(ni, nj, nk, nl));
+
+	harness.run([&] {
+		// initialize data
+		init_array(alpha, beta, A.get_ref(), B.get_ref(), C.get_ref(), D.get_ref());
+	}, [&] {
+		// run kernel
+		kernel_2mm(alpha, beta, tmp.get_ref(), A.get_ref(), B.get_ref(), C.get_ref(), D.get_ref(), tuning.order1, tuning.order2);
+	});
 
 	// print results
+	polybench::results results(params);
+
 	if (argc > 0 && argv[0] != ""s) {
-		std::cout << std::fixed << std::setprecision(2);
-		noarr::serialize_data(std::cout, D.get_ref() ^ noarr::hoist<'i'>());
+		if (results.text()) {
+			std::cout << std::fixed << std::setprecision(2);
+			noarr::serialize_data(std::cout, D.get_ref() ^ noarr::hoist<'i'>());
+		}
+		else {
+			results.write<'i', 'j'>("D", D.get_ref());
+		}
 	}
 
-	std::cerr << std::fixed << std::setprecision(6);
-	std::cerr << duration.count() << std::endl;
+	harness.environment(memory.placement());
+	harness.report(std::cerr);
+	memory.report(std::cerr);
+
+	return 0;
 }
@@ -1,10 +1,14 @@
-#include <chrono>
 #include <iomanip>
 #include <iostream>
 
 #include <noarr/traversers.hpp>
 
 #include "defines.hpp"
+#include "params.hpp"
+#include "harness.hpp"
+#include "affinity.hpp"
+#include "memory.hpp"
+#include "results.hpp"
 #include "3mm.hpp"
 
 using num_t = DATA_TYPE;
@@ -18,6 +22,9 @@ constexpr auto l_vec = noarr::vector<'l'>();
 constexpr auto m_vec = noarr::vector<'m'>();
 
 struct tuning {
+#ifdef TUNING_HEADER
+# include TUNING_HEADER
+#else
 	DEFINE_PROTO_STRUCT(block_i1, noarr::hoist<'i'>());
 	DEFINE_PROTO_STRUCT(block_j1, noarr::hoist<'j'>());
 	DEFINE_PROTO_STRUCT(block_j2, noarr::hoist<'j'>());
@@ -36,6 +43,7 @@ struct tuning {
 	DEFINE_PROTO_STRUCT(c_layout, m_vec ^ j_vec);
 	DEFINE_PROTO_STRUCT(d_layout, l_vec ^ m_vec);
 	DEFINE_PROTO_STRUCT(g_layout, l_vec ^ i_vec);
+#endif
 } tuning;
 
 // initialization function
@@ -107,52 +115,103 @@ void kernel_3mm(auto E, auto A, auto B, auto F, auto C, auto D, auto G, Order1 o
 	#pragma endscop
 }
 
+// floating-point operations of kernel_3mm
+constexpr double flop_count(std::size_t ni, std::size_t nj, std::size_t nk, std::size_t nl, std::size_t nm) {
+	return 2.0 * ni * nj * nk + 2.0 * nj * nl * nm + 2.0 * ni * nj * nl;
+}
+
+// compulsory memory traffic of kernel_3mm in bytes (inputs read and outputs written once)
+constexpr double byte_count(std::size_t ni, std::size_t nj, std::size_t nk, std::size_t nl, std::size_t nm) {
+	return sizeof(num_t) * (1.0 * ni * nk + 1.0 * nk * nj + 1.0 * nj * nm + 1.0 * nm * nl + 1.0 * ni * nj + 1.0 * nj * nl + 1.0 * ni * nl);
+}
+
 } // namespace
 
-int main(int argc, char *argv[]) {
+int KERNEL_MAIN(int argc, char *argv[]) {
 	using namespace std::string_literals;
 
+	// benchmark parameters
+	polybench::params params(argc, argv);
+
 	// problem size
-	std::size_t ni = NI;
-	std::size_t nj = NJ;
-	std::size_t nk = NK;
-	std::size_t nl = NL;
-	std::size_t nm = NM;
+	std::size_t ni = params.size("NI", NI);
+	std::size_t nj = params.size("NJ", NJ);
+	std::size_t nk = params.size("NK", NK);
+	std::size_t nl = params.size("NL", NL);
+	std::size_t nm = params.size("NM", NM);
 
 	auto set_lengths = noarr::set_length<'i'>(ni) ^ noarr::set_length<'j'>(nj) ^ noarr::set_length<'k'>(nk) ^ noarr::set_length<'l'>(nl) ^ noarr::set_length<'m'>(nm);
 
-	// data
-	auto E = noarr::make_bag(noarr::scalar<num_t>() ^ tuning.e_layout ^ set_lengths);
-	auto A = noarr::make_bag(noarr::scalar<num_t>() ^ tuning.a_layout ^ set_lengths);
-	auto B = noarr::make_bag(noarr::scalar<num_t>() ^ tuning.b_layout ^ set_lengths);
-
-	auto F = noarr::make_bag(noarr::scalar<num_t>() ^ tuning.f_layout ^ set_lengths);
-	auto C = noarr::make_bag(noarr::scalar<num_t>() ^ tuning.c_layout ^ set_lengths);
-	auto D = noarr::make_bag(noarr::scalar<num_t>() ^ tuning.d_layout ^ set_lengths);
-
-	auto G = noarr::make_bag(noarr::scalar<num_t>() ^ tuning.g_layout ^ set_lengths);
+	polybench::affinity affinity(params);
+	polybench::memory memory(params);
 
-	// initialize data
-	init_array(A.get_ref(), B.get_ref(), C.get_ref(), D.get_ref());
-
-	auto start = std::chrono::high_resolution_clock::now();
-
-	// run kernel
-	kernel_3mm(E.get_ref(), A.get_ref(), B.get_ref(),
-		F.get_ref(), C.get_ref(), D.get_ref(),
-		G.get_ref(),
-		tuning.order1, tuning.order2, tuning.order3);
-
-	auto end = std::chrono::high_resolution_clock::now();
-
-	auto duration = std::chrono::duration<long double>(end - start);
+	// data
+	auto E = memory.make_bag(noarr::scalar<num_t>() ^ tuning.e_layout ^ set_lengths);
+	auto A = memory.make_bag(noarr::scalar<num_t>() ^ tuning.a_layout ^ set_lengths);
+	auto B = memory.make_bag(noarr::scalar<num_t>() ^ tuning.b_layout ^ set_lengths);
+
+	auto F = memory.make_bag(noarr::scalar<num_t>() ^ tuning.f_layout ^ set_lengths);
+	auto C = memory.make_bag(noarr::scalar<num_t>() ^ tuning.c_layout ^ set_lengths);
+	auto D = memory.make_bag(noarr::scalar<num_t>() ^ tuning.d_layout ^ set_lengths);
+
+	auto G = memory.make_bag(noarr::scalar<num_t>() ^ tuning.g_layout ^ set_lengths);
+
+	polybench::harness harness("3mm", params);
+
+	harness
+		.length("ni", ni)
+		.length("nj", nj)
+		.length("nk", nk)
+		.length("nl", nl)
+		.length("nm", nm)
+		.tuning("block_i1", tuning.block_i1)
+		.tuning("block_j1", tuning.block_j1)
+		.tuning("block_j2", tuning.block_j2)
+		.tuning("block_l2", tuning.block_l2)
+		.tuning("block_i3", tuning.block_i3)
+		.tuning("block_l3", tuning.block_l3)
+		.tuning("order1", tuning.order1)
+		.tuning("order2", tuning.order2)
+		.tuning("order3", tuning.order3)
+		.tuning("e_layout", tuning.e_layout)
+		.tuning("a_layout", tuning.a_layout)
+		.tuning("b_layout", tuning.b_layout)
+		.tuning("f_layout", tuning.f_layout)
+		.tuning("c_layout", tuning.c_layout)
+		.tuning("d_layout", tuning.d_layout)
+		.tuning("g_layout", tuning.g_layout)
+		.environment(affinity.settings())
+		.environment(memory.settings())
+		.flops(flop_count(ni, nj, nk, nl, nm))
+		.bytes(byte_count(ni, nj, nk, nl, nm));
+
+	harness.run([&] {
+		// initialize data
+		init_array(A.get_ref(), B.get_ref(), C.get_ref(), D.get_ref());
+	}, [&] {
+		// run kernel
+		kernel_3mm(E.get_ref(), A.get_ref(), B.get_ref(),
+			F.get_ref(), C.get_ref(), D.get_ref(),
+			G.get_ref(),
+			tuning.order1, tuning.order2, tuning.order3);
+	});
 
 	// print results
+	polybench::results results(params);
+
 	if (argc > 0 && argv[0] != ""s) {
-		std::cout << std::fixed << std::setprecision(2);
-		noarr::serialize_data(std::cout, G.get_ref() ^ noarr::hoist<'i'>());
+		if (results.text()) {
+			std::cout << std::fixed << std::setprecision(2);
+			noarr::serialize_data(std::cout, G.get_ref() ^ noarr::hoist<'i'>());
+		}
+		else {
+			results.write<'i', 'j'>("G", G.get_ref());
+		}
 	}
 
-	std::cerr << std::fixed << std::setprecision(6);
-	std::cerr << duration.count() << std::endl;
+	harness.environment(memory.placement());
+	harness.report(std::cerr);
+	memory.report(std::cerr);
+
+	return 0;
 }
@@ -1,10 +1,14 @@
-#include <chrono>
 #include <iomanip>
 #include <iostream>
 
 #include <noarr/traversers.hpp>
 
 #include "defines.hpp"
+#include "params.hpp"
+#include "harness.hpp"
+#include "affinity.hpp"
+#include "memory.hpp"
+#include "results.hpp"
 #include "atax.hpp"
 
 using num_t = DATA_TYPE;
@@ -15,7 +19,11 @@ constexpr auto i_vec = noarr::vector<'i'>();
 constexpr auto j_vec = noarr::vector<'j'>();
 
 struct tuning {
+#ifdef TUNING_HEADER
+# include TUNING_HEADER
+#else
 	DEFINE_PROTO_STRUCT(c_layout, j_vec ^ i_vec);
+#endif
 } tuning;
 
 // initialization function
@@ -66,41 +74,74 @@ void kernel_atax(auto A, auto x, auto y, auto tmp) {
 	#pragma endscop
 }
 
-} // namespace
-
-int main(int argc, char *argv[]) {
-	using namespace std::string_literals;
-
-	// problem size
-	std::size_t ni = NI;
-	std::size_t nj = NJ;
-
-	// data
-	auto A = noarr::make_bag(noarr::scalar<num_t>() ^ tuning.c_layout ^ noarr::set_length<'i'>(ni) ^ noarr::set_length<'j'>(nj));
+// floating-point operations of kernel_atax
+constexpr double flop_count(std::size_t ni, std::size_t nj) {
+	return 4.0 * ni * nj;
+}
 
-	auto x = noarr::make_bag(noarr::scalar<num_t>() ^ noarr::vector<'j'>(nj));
-	auto y = noarr::make_bag(noarr::scalar<num_t>() ^ noarr::vector<'j'>(nj));
+// compulsory memory traffic of kernel_atax in bytes (inputs read and outputs written once)
+constexpr double byte_count(std::size_t ni, std::size_t nj) {
+	return sizeof(num_t) * (1.0 * ni * nj + 2.0 * nj + ni);
+}
 
-	auto tmp = noarr::make_bag(noarr::scalar<num_t>() ^ noarr::vector<'i'>(ni));
+} // namespace
 
-	// initialize data
-	init_array(A.get_ref(), x.get_ref());
+int KERNEL_MAIN(int argc, char *argv[]) {
+	using namespace std::string_literals;
 
-	auto start = std::chrono::high_resolution_clock::now();
+	// benchmark parameters
+	polybench::params params(argc, argv);
 
-	// run kernel
-	kernel_atax(A.get_ref(), x.get_ref(), y.get_ref(), tmp.get_ref());
+	// problem size
+	std::size_t ni = params.size("NI", NI);
+	std::size_t nj = params.size("NJ", NJ);
 
-	auto end = std::chrono::high_resolution_clock::now();
+	polybench::affinity affinity(params);
+	polybench::memory memory(params);
 
-	auto duration = std::chrono::duration<long double>(end - start);
+	// data
+	auto A = memory.make_bag(noarr::scalar<num_t>() ^ tuning.c_layout ^ noarr::set_length<'i'>(ni) ^ noarr::set_length<'j'>(nj));
+
+	auto x = memory.make_bag(noarr::scalar<num_t>() ^ noarr::vector<'j'>(nj));
+	auto y = memory.make_bag(noarr::scalar<num_t>() ^ noarr::vector<'j'>(nj));
+
+	auto tmp = memory.make_bag(noarr::scalar<num_t>() ^ noarr::vector<'i'>(ni));
+
+	polybench::harness harness("atax", params);
+
+	harness
+		.length("ni", ni)
+		.length("nj", nj)
+		.tuning("c_layout", tuning.c_layout)
+		.environment(affinity.settings())
+		.environment(memory.settings())
+		.flops(flop_count(ni, nj))
+		.bytes(byte_count(ni, nj));
+
+	harness.run([&] {
+		// initialize data
+		init_array(A.get_ref(), x.get_ref());
+	}, [&] {
+		// run kernel
+		kernel_atax(A.get_ref(), x.get_ref(), y.get_ref(), tmp.get_ref());
+	});
 
 	// print results
+	polybench::results results(params);
+
 	if (argc > 0 && argv[0] != ""s) {
-		std::cout << std::fixed << std::setprecision(2);
-		noarr::serialize_data(std::cout, y);
+		if (results.text()) {
+			std::cout << std::fixed << std::setprecision(2);
+			noarr::serialize_data(std::cout, y);
+		}
+		else {
+			results.write<'j'>("y", y.get_ref());
+		}
 	}
 
-	std::cerr << std::fixed << std::setprecision(6);
-	std::cerr << duration.count() << std::endl;
+	harness.environment(memory.placement());
+	harness.report(std::cerr);
+	memory.report(std::cerr);
+
+	return 0;
 }
@@ -1,10 +1,14 @@
-#include <chrono>
 #include <iomanip>
 #include <iostream>
 
 #include <noarr/traversers.hpp>
 
 #include "defines.hpp"
+#include "params.hpp"
+#include "harness.hpp"
+#include "affinity.hpp"
+#include "memory.hpp"
+#include "results.hpp"
 #include "bicg.hpp"
 
 using num_t = DATA_TYPE;
@@ -15,7 +19,11 @@ constexpr auto i_vec = noarr::vector<'i'>();
 constexpr auto j_vec = noarr::vector<'j'>();
 
 struct tuning {
+#ifdef TUNING_HEADER
+# include TUNING_HEADER
+#else
 	DEFINE_PROTO_STRUCT(a_layout, j_vec ^ i_vec);
+#endif
 } tuning;
 
 // initialization function
@@ -72,43 +80,77 @@ void kernel_bicg(auto A, auto s, auto q, auto p, auto r, Order order = {}) {
 	#pragma endscop
 }
 
-} // namespace
-
-int main(int argc, char *argv[]) {
-	using namespace std::string_literals;
-
-	// problem size
-	std::size_t ni = NI;
-	std::size_t nj = NJ;
-
-	// data
-	auto A = noarr::make_bag(noarr::scalar<num_t>() ^ tuning.a_layout ^ noarr::set_length<'i'>(ni) ^ noarr::set_length<'j'>(nj));
+// floating-point operations of kernel_bicg
+constexpr double flop_count(std::size_t ni, std::size_t nj) {
+	return 4.0 * ni * nj;
+}
 
-	auto s = noarr::make_bag(noarr::scalar<num_t>() ^ noarr::vector<'j'>(nj));
-	auto q = noarr::make_bag(noarr::scalar<num_t>() ^ noarr::vector<'i'>(ni));
+// compulsory memory traffic of kernel_bicg in bytes (inputs read and outputs written once)
+constexpr double byte_count(std::size_t ni, std::size_t nj) {
+	return sizeof(num_t) * (1.0 * ni * nj + 2.0 * ni + 2.0 * nj);
+}
 
-	auto p = noarr::make_bag(noarr::scalar<num_t>() ^ noarr::vector<'j'>(nj));
-	auto r = noarr::make_bag(noarr::scalar<num_t>() ^ noarr::vector<'i'>(ni));
+} // namespace
 
-	// initialize data
-	init_array(A.get_ref(), r.get_ref(), p.get_ref());
+int KERNEL_MAIN(int argc, char *argv[]) {
+	using namespace std::string_literals;
 
-	auto start = std::chrono::high_resolution_clock::now();
+	// benchmark parameters
+	polybench::params params(argc, argv);
 
-	// run kernel
-	kernel_bicg(A.get_ref(), s.get_ref(), q.get_ref(), p.get_ref(), r.get_ref());
+	// problem size
+	std::size_t ni = params.size("NI", NI);
+	std::size_t nj = params.size("NJ", NJ);
 
-	auto end = std::chrono::high_resolution_clock::now();
+	polybench::affinity affinity(params);
+	polybench::memory memory(params);
 
-	auto duration = std::chrono::duration<long double>(end - start);
+	// data
+	auto A = memory.make_bag(noarr::scalar<num_t>() ^ tuning.a_layout ^ noarr::set_length<'i'>(ni) ^ noarr::set_length<'j'>(nj));
+
+	auto s = memory.make_bag(noarr::scalar<num_t>() ^ noarr::vector<'j'>(nj));
+	auto q = memory.make_bag(noarr::scalar<num_t>() ^ noarr::vector<'i'>(ni));
+
+	auto p = memory.make_bag(noarr::scalar<num_t>() ^ noarr::vector<'j'>(nj));
+	auto r = memory.make_bag(noarr::scalar<num_t>() ^ noarr::vector<'i'>(ni));
+
+	polybench::harness harness("bicg", params);
+
+	harness
+		.length("ni", ni)
+		.length("nj", nj)
+		.tuning("a_layout", tuning.a_layout)
+		.environment(affinity.settings())
+		.environment(memory.settings())
+		.flops(flop_count(ni, nj))
+		.bytes(byte_count(ni, nj));
+
+	harness.run([&] {
+		// initialize data
+		init_array(A.get_ref(), r.get_ref(), p.get_ref());
+	}, [&] {
+		// run kernel
+		kernel_bicg(A.get_ref(), s.get_ref(), q.get_ref(), p.get_ref(), r.get_ref());
+	});
 
 	// print results
+	polybench::results results(params);
+
 	if (argc > 0 && argv[0] != ""s) {
-		std::cout << std::fixed << std::setprecision(2);
-		noarr::serialize_data(std::cout, s);
-		noarr::serialize_data(std::cout, q);
+		if (results.text()) {
+			std::cout << std::fixed << std::setprecision(2);
+			noarr::serialize_data(std::cout, s);
+			noarr::serialize_data(std::cout, q);
+		}
+		else {
+			results.write<'j'>("s", s.get_ref());
+			results.write<'i'>("q", q.get_ref());
+		}
 	}
 
-	std::cerr << std::fixed << std::setprecision(6);
-	std::cerr << duration.count() << std::endl;
+	harness.environment(memory.placement());
+	harness.report(std::cerr);
+	memory.report(std::cerr);
+
+	return 0;
 }
@@ -1,10 +1,14 @@
-#include <chrono>
 #include <iomanip>
 #include <iostream>
 
 #include <noarr/traversers.hpp>
 
 #include "defines.hpp"
+#include "params.hpp"
+#include "harness.hpp"
+#include "affinity.hpp"
+#include "memory.hpp"
+#include "results.hpp"
 #include "doitgen.hpp"
 
 using num_t = DATA_TYPE;
@@ -17,6 +21,9 @@ constexpr auto p_vec = noarr::vector<'p'>();
 constexpr auto s_vec = noarr::vector<'s'>();
 
 struct tuning {
+#ifdef TUNING_HEADER
+# include TUNING_HEADER
+#else
 	DEFINE_PROTO_STRUCT(block_r, noarr::hoist<'r'>());
 	DEFINE_PROTO_STRUCT(block_q, noarr::hoist<'q'>());
 
@@ -24,6 +31,7 @@ struct tuning {
 
 	DEFINE_PROTO_STRUCT(a_layout, p_vec ^ q_vec ^ r_vec);
 	DEFINE_PROTO_STRUCT(c4_layout, p_vec ^ s_vec);
+#endif
 } tuning;
 
 // initialization function
@@ -73,41 +81,79 @@ void kernel_doitgen(auto A, auto C4, auto sum, Order order = {}) {
 	#pragma endscop
 }
 
+// floating-point operations of kernel_doitgen
+constexpr double flop_count(std::size_t nr, std::size_t nq, std::size_t np) {
+	return 2.0 * nr * nq * np * np;
+}
+
+// compulsory memory traffic of kernel_doitgen in bytes (inputs read and outputs written once)
+constexpr double byte_count(std::size_t nr, std::size_t nq, std::size_t np) {
+	return sizeof(num_t) * (2.0 * nr * nq * np + 1.0 * np * np + np);
+}
+
 } // namespace
 
-int main(int argc, char *argv[]) {
+int KERNEL_MAIN(int argc, char *argv[]) {
 	using namespace std::string_literals;
 
+	// benchmark parameters
+	polybench::params params(argc, argv);
+
 	// problem size
-	std::size_t nr = NR;
-	std::size_t nq = NQ;
-	std::size_t np = NP;
+	std::size_t nr = params.size("NR", NR);
+	std::size_t nq = params.size("NQ", NQ);
+	std::size_t np = params.size("NP", NP);
 
 	auto set_lengths = noarr::set_length<'r'>(nr) ^ noarr::set_length<'q'>(nq) ^ noarr::set_length<'s'>(np) ^ noarr::set_length<'p'>(np);
 
-	// data
-	auto A = noarr::make_bag(noarr::scalar<num_t>() ^ tuning.a_layout ^ set_lengths);
-	auto sum = noarr::make_bag(noarr::scalar<num_t>() ^ noarr::vector<'p'>(np));
-	auto C4 = noarr::make_bag(noarr::scalar<num_t>() ^ tuning.c4_layout ^ set_lengths);
-
-	// initialize data
-	init_array(A.get_ref(), C4.get_ref());
+	polybench::affinity affinity(params);
+	polybench::memory memory(params);
 
-	auto start = std::chrono::high_resolution_clock::now();
-
-	// run kernel
-	kernel_doitgen(A.get_ref(), C4.get_ref(), sum.get_ref(), tuning.order);
-
-	auto end = std::chrono::high_resolution_clock::now();
-
-	auto duration = std::chrono::duration<long double>(end - start);
+	// data
+	auto A = memory.make_bag(noarr::scalar<num_t>() ^ tuning.a_layout ^ set_lengths);
+	auto sum = memory.make_bag(noarr::scalar<num_t>() ^ noarr::vector<'p'>(np));
+	auto C4 = memory.make_bag(noarr::scalar<num_t>() ^ tuning.c4_layout ^ set_lengths);
+
+	polybench::harness harness("doitgen", params);
+
+	harness
+		.length("nr", nr)
+		.length("nq", nq)
+		.length("np", np)
+		.tuning("block_r", tuning.block_r)
+		.tuning("block_q", tuning.block_q)
+		.tuning("order", tuning.order)
+		.tuning("a_layout", tuning.a_layout)
+		.tuning("c4_layout", tuning.c4_layout)
+		.environment(affinity.settings())
+		.environment(memory.settings())
+		.flops(flop_count(nr, nq, np))
+		.bytes(byte_count(nr, nq, np));
+
+	harness.run([&] {
+		// initialize data
+		init_array(A.get_ref(), C4.get_ref());
+	}, [&] {
+		// run kernel
+		kernel_doitgen(A.get_ref(), C4.get_ref(), sum.get_ref(), tuning.order);
+	});
 
 	// print results
+	polybench::results results(params);
+
 	if (argc > 0 && argv[0] != ""s) {
-		std::cout << std::fixed << std::setprecision(2);
-		noarr::serialize_data(std::cout, A.get_ref() ^ noarr::reorder<'r', 'q', 'p'>());
+		if (results.text()) {
+			std::cout << std::fixed << std::setprecision(2);
+			noarr::serialize_data(std::cout, A.get_ref() ^ noarr::reorder<'r', 'q', 'p'>());
+		}
+		else {
+			results.write<'r', 'q', 'p'>("A", A.get_ref());
+		}
 	}
 
-	std::cerr << std::fixed << std::setprecision(6);
-	std::cerr << duration.count() << std::endl;
+	harness.environment(memory.placement());
+	harness.report(std::cerr);
+	memory.report(std::cerr);
+
+	return 0;
 }
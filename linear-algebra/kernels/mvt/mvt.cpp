@@ -1,10 +1,14 @@
-#include <chrono>
 #include <iomanip>
 #include <iostream>
 
 #include <noarr/traversers.hpp>
 
 #include "defines.hpp"
+#include "params.hpp"
+#include "harness.hpp"
+#include "affinity.hpp"
+#include "memory.hpp"
+#include "results.hpp"
 #include "mvt.hpp"
 
 using num_t = DATA_TYPE;
@@ -15,6 +19,9 @@ constexpr auto i_vec = noarr::vector<'i'>();
 constexpr auto j_vec = noarr::vector<'j'>();
 
 struct tuning {
+#ifdef TUNING_HEADER
+# include TUNING_HEADER
+#else
 	DEFINE_PROTO_STRUCT(block_i1, noarr::hoist<'i'>());
 	DEFINE_PROTO_STRUCT(block_j1, noarr::hoist<'j'>());
 	DEFINE_PROTO_STRUCT(block_i2, noarr::hoist<'i'>());
@@ -24,6 +31,7 @@ struct tuning {
 	DEFINE_PROTO_STRUCT(order2, block_j2 ^ block_i2);
 
 	DEFINE_PROTO_STRUCT(a_layout, j_vec ^ i_vec);
+#endif
 } tuning;
 
 // initialization function
@@ -82,42 +90,81 @@ void kernel_mvt(auto x1, auto x2, auto y1, auto y2, auto A, Order1 order1 = {},
 	#pragma endscop
 }
 
-} // namespace
-
-int main(int argc, char *argv[]) {
-	using namespace std::string_literals;
-
-	// problem size
-	std::size_t n = N;
-
-	// data
-	auto x1 = noarr::make_bag(noarr::scalar<num_t>() ^ noarr::vector<'i'>(n));
-	auto x2 = noarr::make_bag(noarr::scalar<num_t>() ^ noarr::vector<'i'>(n));
+// floating-point operations of kernel_mvt
+constexpr double flop_count(std::size_t n) {
+	return 4.0 * n * n;
+}
 
-	auto y1 = noarr::make_bag(noarr::scalar<num_t>() ^ noarr::vector<'j'>(n));
-	auto y2 = noarr::make_bag(noarr::scalar<num_t>() ^ noarr::vector<'j'>(n));
+// compulsory memory traffic of kernel_mvt in bytes (inputs read and outputs written once)
+constexpr double byte_count(std::size_t n) {
+	return sizeof(num_t) * (1.0 * n * n + 6.0 * n);
+}
 
-	auto A = noarr::make_bag(noarr::scalar<num_t>() ^ tuning.a_layout ^ noarr::set_length<'i'>(n) ^ noarr::set_length<'j'>(n));
+} // namespace
 
-	// initialize data
-	init_array(x1.get_ref(), x2.get_ref(), y1.get_ref(), y2.get_ref(), A.get_ref());
+int KERNEL_MAIN(int argc, char *argv[]) {
+	using namespace std::string_literals;
 
-	auto start = std::chrono::high_resolution_clock::now();
+	// benchmark parameters
+	polybench::params params(argc, argv);
 
-	// run kernel
-	kernel_mvt(x1.get_ref(), x2.get_ref(), y1.get_ref(), y2.get_ref(), A.get_ref(), tuning.order1, tuning.order2);
+	// problem size
+	std::size_t n = params.size("N", N);
 
-	auto end = std::chrono::high_resolution_clock::now();
+	polybench::affinity affinity(params);
+	polybench::memory memory(params);
 
-	auto duration = std::chrono::duration<long double>(end - start);
+	// data
+	auto x1 = memory.make_bag(noarr::scalar<num_t>() ^ noarr::vector<'i'>(n));
+	auto x2 = memory.make_bag(noarr::scalar<num_t>() ^ noarr::vector<'i'>(n));
+
+	auto y1 = memory.make_bag(noarr::scalar<num_t>() ^ noarr::vector<'j'>(n));
+	auto y2 = memory.make_bag(noarr::scalar<num_t>() ^ noarr::vector<'j'>(n));
+
+	auto A = memory.make_bag(noarr::scalar<num_t>() ^ tuning.a_layout ^ noarr::set_length<'i'>(n) ^ noarr::set_length<'j'>(n));
+
+	polybench::harness harness("mvt", params);
+
+	harness
+		.length("n", n)
+		.tuning("block_i1", tuning.block_i1)
+		.tuning("block_j1", tuning.block_j1)
+		.tuning("block_i2", tuning.block_i2)
+		.tuning("block_j2", tuning.block_j2)
+		.tuning("order1", tuning.order1)
+		.tuning("order2", tuning.order2)
+		.tuning("a_layout", tuning.a_layout)
+		.environment(affinity.settings())
+		.environment(memory.settings())
+		.flops(flop_count(n))
+		.bytes(byte_count(n));
+
+	harness.run([&] {
+		// initialize data
+		init_array(x1.get_ref(), x2.get_ref(), y1.get_ref(), y2.get_ref(), A.get_ref());
+	}, [&] {
+		// run kernel
+		kernel_mvt(x1.get_ref(), x2.get_ref(), y1.get_ref(), y2.get_ref(), A.get_ref(), tuning.order1, tuning.order2);
+	});
 
 	// print results
+	polybench::results results(params);
+
 	if (argc > 0 && argv[0] != ""s) {
-		std::cout << std::fixed << std::setprecision(2);
-		noarr::serialize_data(std::cout, x1);
-		noarr::serialize_data(std::cout, x2);
+		if (results.text()) {
+			std::cout << std::fixed << std::setprecision(2);
+			noarr::serialize_data(std::cout, x1);
+			noarr::serialize_data(std::cout, x2);
+		}
+		else {
+			results.write<'i'>("x1", x1.get_ref());
+			results.write<'i'>("x2", x2.get_ref());
+		}
 	}
 
-	std::cerr << std::fixed << std::setprecision(6);
-	std::cerr << duration.count() << std::endl;
+	harness.environment(memory.placement());
+	harness.report(std::cerr);
+	memory.report(std::cerr);
+
+	return 0;
 }
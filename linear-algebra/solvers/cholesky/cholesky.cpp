@@ -1,4 +1,4 @@
-#include <chrono>
+#include <algorithm>
 #include <cmath>
 #include <iomanip>
 #include <iostream>
@@ -6,6 +6,12 @@
 #include <noarr/traversers.hpp>
 
 #include "defines.hpp"
+#include "params.hpp"
+#include "harness.hpp"
+#include "affinity.hpp"
+#include "memory.hpp"
+#include "results.hpp"
+#include "triangle.hpp"
 #include "cholesky.hpp"
 
 using num_t = DATA_TYPE;
@@ -16,7 +22,15 @@ constexpr auto i_vec = noarr::vector<'i'>();
 constexpr auto j_vec = noarr::vector<'j'>();
 
 struct tuning {
+#ifdef TUNING_HEADER
+# include TUNING_HEADER
+#else
 	DEFINE_PROTO_STRUCT(a_layout, j_vec ^ i_vec);
+
+	// kernel_cholesky_blocked: panels of block_size columns, trailing update in block_size x block_size tiles
+	AUTO_FIELD(blocked, false);
+	AUTO_FIELD(block_size, (std::size_t)64);
+#endif
 } tuning;
 
 // initialization function
@@ -96,42 +110,156 @@ void kernel_cholesky(auto A) {
 	#pragma endscop
 }
 
-} // namespace
+// the sum of A[i, k] * A[j, k] over k in [k0, k1)
+[[gnu::always_inline]]
+inline num_t cholesky_dot(auto A, std::size_t i, std::size_t j, std::size_t k0, std::size_t k1) {
+	// A: i x j
+	using namespace noarr;
 
-int main(int argc, char *argv[]) {
-	using namespace std::string_literals;
+	num_t sum = 0;
 
-	// problem size
-	std::size_t n = N;
+	#pragma omp simd reduction(+:sum)
+	for (std::size_t k = k0; k < k1; ++k)
+		sum += A[idx<'i'>(i) & idx<'j'>(k)] * A[idx<'i'>(j) & idx<'j'>(k)];
 
-	// data
-	auto A = noarr::make_bag(noarr::scalar<num_t>() ^ tuning.a_layout ^ noarr::set_length<'i'>(n) ^ noarr::set_length<'j'>(n));
+	return sum;
+}
 
-	// initialize data
-	init_array(A.get_ref());
+// blocked right-looking multi-threaded computation kernel
+//
+// For each panel of block_size columns: the diagonal tile is factorized, the
+// rows below it are solved against it (in parallel), and the panel is
+// subtracted from the remaining lower triangle tile by tile (in parallel).
+[[gnu::flatten, gnu::noinline]]
+void kernel_cholesky_blocked(auto A, std::size_t block_size) {
+	// A: i x j
+	using namespace noarr;
 
-	auto start = std::chrono::high_resolution_clock::now();
+	const std::size_t n = A | get_length<'i'>();
+	const std::size_t blocks = (n + block_size - 1) / block_size;
+
+	#pragma omp parallel
+	for (std::size_t kb = 0; kb < blocks; ++kb) {
+		const std::size_t k0 = kb * block_size, k1 = std::min(k0 + block_size, n);
+
+		// panel factorization: the diagonal tile
+		#pragma omp single
+		for (std::size_t i = k0; i < k1; ++i) {
+			for (std::size_t j = k0; j < i; ++j) {
+				A[idx<'i'>(i) & idx<'j'>(j)] -= cholesky_dot(A, i, j, k0, j);
+				A[idx<'i'>(i) & idx<'j'>(j)] /= A[idx<'i'>(j) & idx<'j'>(j)];
+			}
+
+			A[idx<'i'>(i) & idx<'j'>(i)] -= cholesky_dot(A, i, i, k0, i);
+			A[idx<'i'>(i) & idx<'j'>(i)] = std::sqrt(A[idx<'i'>(i) & idx<'j'>(i)]);
+		}
+
+		// triangular solve: the rows of the panel below the diagonal tile
+		#pragma omp for schedule(static)
+		for (std::size_t i = k1; i < n; ++i) {
+			for (std::size_t j = k0; j < k1; ++j) {
+				A[idx<'i'>(i) & idx<'j'>(j)] -= cholesky_dot(A, i, j, k0, j);
+				A[idx<'i'>(i) & idx<'j'>(j)] /= A[idx<'i'>(j) & idx<'j'>(j)];
+			}
+		}
+
+		// trailing update (SYRK on the diagonal tiles, GEMM below them), over the tiles of the lower triangle
+		const std::size_t tiles = polybench::triangle_tiles(blocks - kb - 1);
+
+		#pragma omp for schedule(dynamic)
+		for (std::size_t t = 0; t < tiles; ++t) {
+			const auto [row, col] = polybench::lower_triangle_tile(t);
+			const std::size_t ib = kb + 1 + row, jb = kb + 1 + col;
+
+			const std::size_t i0 = ib * block_size, i1 = std::min(i0 + block_size, n);
+			const std::size_t j0 = jb * block_size, j1 = std::min(j0 + block_size, n);
+
+			for (std::size_t i = i0; i < i1; ++i)
+				for (std::size_t j = j0; j < std::min(j1, i + 1); ++j)
+					A[idx<'i'>(i) & idx<'j'>(j)] -= cholesky_dot(A, i, j, k0, k1);
+		}
+	}
+}
 
-	// run kernel
-	kernel_cholesky(A.get_ref());
+// floating-point operations of kernel_cholesky
+constexpr double flop_count(std::size_t n) {
+	return (n - 1.0) * n * (n + 1.0) / 3 + 1.5 * n * (n - 1.0) + n;
+}
 
-	auto end = std::chrono::high_resolution_clock::now();
+// compulsory memory traffic of kernel_cholesky in bytes (inputs read and outputs written once)
+constexpr double byte_count(std::size_t n) {
+	return sizeof(num_t) * 2.0 * n * n;
+}
 
-	auto duration = std::chrono::duration<long double>(end - start);
+} // namespace
 
-	// print results
-	if (argc > 0 && argv[0] != ""s) [A = A.get_ref()] {
-		std::cout << std::fixed << std::setprecision(2);
-		noarr::traverser(A) | noarr::for_dims<'i'>([=](auto inner) {
-			inner ^ noarr::span<'j'>(noarr::get_index<'i'>(inner) + 1) |
-				[=](auto state) {
-					std::cout << A[state] << " ";
-				};
-
-			std::cout << std::endl;
-		});
-	}();
+int KERNEL_MAIN(int argc, char *argv[]) {
+	using namespace std::string_literals;
+
+	// benchmark parameters
+	polybench::params params(argc, argv);
 
-	std::cerr << std::fixed << std::setprecision(6);
-	std::cerr << duration.count() << std::endl;
+	// the sizes of the selected variant
+	if (tuning.blocked) {
+		polybench::require_tuning_size("block_size", tuning.block_size);
+	}
+
+	// problem size
+	std::size_t n = params.size("N", N);
+
+	polybench::affinity affinity(params);
+	polybench::memory memory(params);
+
+	// data (partitioned into the rows of tiles of kernel_cholesky_blocked)
+	auto A = memory.make_bag(noarr::scalar<num_t>() ^ tuning.a_layout ^ noarr::set_length<'i'>(n) ^ noarr::set_length<'j'>(n),
+		polybench::partition<'i'>{tuning.block_size});
+
+	polybench::harness harness("cholesky", params);
+
+	harness
+		.length("n", n)
+		.tuning("a_layout", tuning.a_layout)
+		.tuning("blocked", tuning.blocked)
+		.tuning("block_size", tuning.block_size)
+		.environment(affinity.settings())
+		.environment(memory.settings())
+		.flops(flop_count(n))
+		.bytes(byte_count(n));
+
+	harness.run([&] {
+		// initialize data
+		init_array(A.get_ref());
+	}, [&] {
+		// run kernel
+		if (tuning.blocked)
+			kernel_cholesky_blocked(A.get_ref(), tuning.block_size);
+		else
+			kernel_cholesky(A.get_ref());
+	});
+
+	// print results
+	polybench::results results(params);
+
+	if (argc > 0 && argv[0] != ""s) {
+		if (results.text()) [A = A.get_ref()] {
+			std::cout << std::fixed << std::setprecision(2);
+			noarr::traverser(A) | noarr::for_dims<'i'>([=](auto inner) {
+				inner ^ noarr::span<'j'>(noarr::get_index<'i'>(inner) + 1) |
+					[=](auto state) {
+						std::cout << A[state] << " ";
+					};
+
+				std::cout << std::endl;
+			});
+		}();
+		else {
+			results.write<'i', 'j'>("A", A.get_ref());
+		}
+	}
+
+	harness.environment(memory.placement());
+	harness.report(std::cerr);
+	memory.report(std::cerr);
+
+	return 0;
 }
@@ -1,10 +1,14 @@
-#include <chrono>
 #include <iomanip>
 #include <iostream>
 
 #include <noarr/traversers.hpp>
 
 #include "defines.hpp"
+#include "params.hpp"
+#include "harness.hpp"
+#include "affinity.hpp"
+#include "memory.hpp"
+#include "results.hpp"
 #include "durbin.hpp"
 
 using num_t = DATA_TYPE;
@@ -72,36 +76,67 @@ void kernel_durbin(auto r, auto y) {
 	#pragma endscop
 }
 
-} // namespace
-
-int main(int argc, char *argv[]) {
-	using namespace std::string_literals;
+// floating-point operations of kernel_durbin
+constexpr double flop_count(std::size_t n) {
+	return 2.0 * n * (n - 1.0) + 6.0 * (n - 1.0);
+}
 
-	// problem size
-	std::size_t n = N;
+// compulsory memory traffic of kernel_durbin in bytes (inputs read and outputs written once)
+constexpr double byte_count(std::size_t n) {
+	return sizeof(num_t) * 2.0 * n;
+}
 
-	// data
-	auto r = noarr::make_bag(noarr::scalar<num_t>() ^ noarr::vector<'i'>(n));
-	auto y = noarr::make_bag(noarr::scalar<num_t>() ^ noarr::vector<'i'>(n));
+} // namespace
 
-	// initialize data
-	init_array(r.get_ref());
+int KERNEL_MAIN(int argc, char *argv[]) {
+	using namespace std::string_literals;
 
-	auto start = std::chrono::high_resolution_clock::now();
+	// benchmark parameters
+	polybench::params params(argc, argv);
 
-	// run kernel
-	kernel_durbin(r.get_ref(), y.get_ref());
+	// problem size
+	std::size_t n = params.size("N", N);
 
-	auto end = std::chrono::high_resolution_clock::now();
+	polybench::affinity affinity(params);
+	polybench::memory memory(params);
 
-	auto duration = std::chrono::duration<long double>(end - start);
+	// data
+	auto r = memory.make_bag(noarr::scalar<num_t>() ^ noarr::vector<'i'>(n));
+	auto y = memory.make_bag(noarr::scalar<num_t>() ^ noarr::vector<'i'>(n));
+
+	polybench::harness harness("durbin", params);
+
+	harness
+		.length("n", n)
+		.environment(affinity.settings())
+		.environment(memory.settings())
+		.flops(flop_count(n))
+		.bytes(byte_count(n));
+
+	harness.run([&] {
+		// initialize data
+		init_array(r.get_ref());
+	}, [&] {
+		// run kernel
+		kernel_durbin(r.get_ref(), y.get_ref());
+	});
 
 	// print results
+	polybench::results results(params);
+
 	if (argc > 0 && argv[0] != ""s) {
-		std::cout << std::fixed << std::setprecision(2);
-		noarr::serialize_data(std::cout, y);
+		if (results.text()) {
+			std::cout << std::fixed << std::setprecision(2);
+			noarr::serialize_data(std::cout, y);
+		}
+		else {
+			results.write<'i'>("y", y.get_ref());
+		}
 	}
 
-	std::cerr << std::fixed << std::setprecision(6);
-	std::cerr << duration.count() << std::endl;
+	harness.environment(memory.placement());
+	harness.report(std::cerr);
+	memory.report(std::cerr);
+
+	return 0;
 }
@@ -1,4 +1,3 @@
-#include <chrono>
 #include <cmath>
 #include <iomanip>
 #include <iostream>
@@ -6,6 +5,11 @@
 #include <noarr/traversers.hpp>
 
 #include "defines.hpp"
+#include "params.hpp"
+#include "harness.hpp"
+#include "affinity.hpp"
+#include "memory.hpp"
+#include "results.hpp"
 #include "gramschmidt.hpp"
 
 using num_t = DATA_TYPE;
@@ -17,9 +21,13 @@ constexpr auto j_vec = noarr::vector<'j'>();
 constexpr auto k_vec = noarr::vector<'k'>();
 
 struct tuning {
+#ifdef TUNING_HEADER
+# include TUNING_HEADER
+#else
 	DEFINE_PROTO_STRUCT(a_layout, k_vec ^ i_vec);
 	DEFINE_PROTO_STRUCT(r_layout, j_vec ^ k_vec);
 	DEFINE_PROTO_STRUCT(q_layout, k_vec ^ i_vec);
+#endif
 } tuning;
 
 // initialization function
@@ -87,39 +95,75 @@ void kernel_gramschmidt(auto A, auto R, auto Q) {
 	#pragma endscop
 }
 
-} // namespace
-
-int main(int argc, char *argv[]) {
-	using namespace std::string_literals;
+// floating-point operations of kernel_gramschmidt
+constexpr double flop_count(std::size_t ni, std::size_t nj) {
+	return 2.0 * ni * nj * (nj - 1.0) + 3.0 * ni * nj;
+}
 
-	// problem size
-	std::size_t ni = NI;
-	std::size_t nj = NJ;
+// compulsory memory traffic of kernel_gramschmidt in bytes (inputs read and outputs written once)
+constexpr double byte_count(std::size_t ni, std::size_t nj) {
+	return sizeof(num_t) * (3.0 * ni * nj + 1.0 * nj * nj);
+}
 
-	// data
-	auto A = noarr::make_bag(noarr::scalar<num_t>() ^ tuning.a_layout ^ noarr::set_length<'i'>(ni) ^ noarr::set_length<'k'>(nj));
-	auto R = noarr::make_bag(noarr::scalar<num_t>() ^ tuning.r_layout ^ noarr::set_length<'k'>(nj) ^ noarr::set_length<'j'>(nj));
-	auto Q = noarr::make_bag(noarr::scalar<num_t>() ^ tuning.q_layout ^ noarr::set_length<'i'>(ni) ^ noarr::set_length<'k'>(nj));
+} // namespace
 
-	// initialize data
-	init_array(A.get_ref(), R.get_ref(), Q.get_ref());
+int KERNEL_MAIN(int argc, char *argv[]) {
+	using namespace std::string_literals;
 
-	auto start = std::chrono::high_resolution_clock::now();
+	// benchmark parameters
+	polybench::params params(argc, argv);
 
-	// run kernel
-	kernel_gramschmidt(A.get_ref(), R.get_ref(), Q.get_ref());
+	// problem size
+	std::size_t ni = params.size("NI", NI);
+	std::size_t nj = params.size("NJ", NJ);
 
-	auto end = std::chrono::high_resolution_clock::now();
+	polybench::affinity affinity(params);
+	polybench::memory memory(params);
 
-	auto duration = std::chrono::duration<long double>(end - start);
+	// data
+	auto A = memory.make_bag(noarr::scalar<num_t>() ^ tuning.a_layout ^ noarr::set_length<'i'>(ni) ^ noarr::set_length<'k'>(nj));
+	auto R = memory.make_bag(noarr::scalar<num_t>() ^ tuning.r_layout ^ noarr::set_length<'k'>(nj) ^ noarr::set_length<'j'>(nj));
+	auto Q = memory.make_bag(noarr::scalar<num_t>() ^ tuning.q_layout ^ noarr::set_length<'i'>(ni) ^ noarr::set_length<'k'>(nj));
+
+	polybench::harness harness("gramschmidt", params);
+
+	harness
+		.length("ni", ni)
+		.length("nj", nj)
+		.tuning("a_layout", tuning.a_layout)
+		.tuning("r_layout", tuning.r_layout)
+		.tuning("q_layout", tuning.q_layout)
+		.environment(affinity.settings())
+		.environment(memory.settings())
+		.flops(flop_count(ni, nj))
+		.bytes(byte_count(ni, nj));
+
+	harness.run([&] {
+		// initialize data
+		init_array(A.get_ref(), R.get_ref(), Q.get_ref());
+	}, [&] {
+		// run kernel
+		kernel_gramschmidt(A.get_ref(), R.get_ref(), Q.get_ref());
+	});
 
 	// print results
+	polybench::results results(params);
+
 	if (argc > 0 && argv[0] != ""s) {
-		std::cout << std::fixed << std::setprecision(2);
-		noarr::serialize_data(std::cout, R.get_ref() ^ noarr::hoist<'k'>());
-		noarr::serialize_data(std::cout, Q.get_ref() ^ noarr::hoist<'i'>());
+		if (results.text()) {
+			std::cout << std::fixed << std::setprecision(2);
+			noarr::serialize_data(std::cout, R.get_ref() ^ noarr::hoist<'k'>());
+			noarr::serialize_data(std::cout, Q.get_ref() ^ noarr::hoist<'i'>());
+		}
+		else {
+			results.write<'k', 'j'>("R", R.get_ref());
+			results.write<'i', 'k'>("Q", Q.get_ref());
+		}
 	}
 
-	std::cerr << std::fixed << std::setprecision(6);
-	std::cerr << duration.count() << std::endl;
+	harness.environment(memory.placement());
+	harness.report(std::cerr);
+	memory.report(std::cerr);
+
+	return 0;
 }
@@ -1,10 +1,16 @@
-#include <chrono>
+#include <algorithm>
 #include <iomanip>
 #include <iostream>
+#include <vector>
 
 #include <noarr/traversers.hpp>
 
 #include "defines.hpp"
+#include "params.hpp"
+#include "harness.hpp"
+#include "affinity.hpp"
+#include "memory.hpp"
+#include "results.hpp"
 #include "lu.hpp"
 
 using num_t = DATA_TYPE;
@@ -15,9 +21,17 @@ constexpr auto i_vec = noarr::vector<'i'>();
 constexpr auto j_vec = noarr::vector<'j'>();
 
 struct tuning {
+#ifdef TUNING_HEADER
+# include TUNING_HEADER
+#else
 	DEFINE_PROTO_STRUCT(order, noarr::hoist<'j'>());
 
 	DEFINE_PROTO_STRUCT(a_layout, j_vec ^ i_vec);
+
+	// kernel_lu_tiled: block_size x block_size tiles, each tile operation an OpenMP task
+	AUTO_FIELD(tiled, false);
+	AUTO_FIELD(block_size, (std::size_t)64);
+#endif
 } tuning;
 
 // initialization function
@@ -92,35 +106,157 @@ void kernel_lu(auto A, Order order = {}) {
 	#pragma endscop
 }
 
-} // namespace
+// A[i, j] -= A[i, k] * A[k, j] for j in [j0, j1)
+[[gnu::always_inline]]
+inline void lu_row_update(auto A, std::size_t i, std::size_t k, std::size_t j0, std::size_t j1) {
+	// A: i x j
+	using namespace noarr;
 
-int main(int argc, char *argv[]) {
-	using namespace std::string_literals;
+	const num_t A_ik = A[idx<'i'>(i) & idx<'j'>(k)];
 
-	// problem size
-	std::size_t n = N;
+	#pragma omp simd
+	for (std::size_t j = j0; j < j1; ++j)
+		A[idx<'i'>(i) & idx<'j'>(j)] -= A_ik * A[idx<'i'>(k) & idx<'j'>(j)];
+}
 
-	// data
-	auto A = noarr::make_bag(noarr::scalar<num_t>() ^ tuning.a_layout ^ noarr::set_length<'i'>(n) ^ noarr::set_length<'j'>(n));
+// tiled task-parallel computation kernel
+//
+// The tile operations (factorization of a diagonal tile, triangular solves of
+// the tiles in its row and column, updates of the trailing tiles) are OpenMP
+// tasks ordered only by the tiles they read and write, so the next panel can
+// be factorized while the trailing updates of the previous one still run.
+// Every element receives its updates in the same order as in kernel_lu.
+[[gnu::flatten, gnu::noinline]]
+void kernel_lu_tiled(auto A, std::size_t block_size) {
+	// A: i x j
+	using namespace noarr;
+
+	const std::size_t n = A | get_length<'i'>();
+	const std::size_t blocks = (n + block_size - 1) / block_size;
+
+	// dependency tokens of the tiles
+	std::vector<char> tiles(blocks * blocks);
+	char *tile = tiles.data();
+
+	#pragma omp parallel
+	#pragma omp single
+	for (std::size_t kb = 0; kb < blocks; ++kb) {
+		const std::size_t k0 = kb * block_size, k1 = std::min(k0 + block_size, n);
+
+		// GETRF: the diagonal tile
+		#pragma omp task depend(inout: tile[kb * blocks + kb])
+		for (std::size_t i = k0; i < k1; ++i) {
+			for (std::size_t k = k0; k < i; ++k) {
+				A[idx<'i'>(i) & idx<'j'>(k)] /= A[idx<'i'>(k) & idx<'j'>(k)];
+				lu_row_update(A, i, k, k + 1, k1);
+			}
+		}
+
+		// TRSM: the tiles in the row and in the column of the diagonal tile
+		for (std::size_t b = kb + 1; b < blocks; ++b) {
+			const std::size_t b0 = b * block_size, b1 = std::min(b0 + block_size, n);
+
+			#pragma omp task depend(in: tile[kb * blocks + kb]) depend(inout: tile[kb * blocks + b])
+			for (std::size_t i = k0; i < k1; ++i)
+				for (std::size_t k = k0; k < i; ++k)
+					lu_row_update(A, i, k, b0, b1);
+
+			#pragma omp task depend(in: tile[kb * blocks + kb]) depend(inout: tile[b * blocks + kb])
+			for (std::size_t i = b0; i < b1; ++i) {
+				for (std::size_t k = k0; k < k1; ++k) {
+					A[idx<'i'>(i) & idx<'j'>(k)] /= A[idx<'i'>(k) & idx<'j'>(k)];
+					lu_row_update(A, i, k, k + 1, k1);
+				}
+			}
+		}
+
+		// GEMM: the trailing tiles
+		for (std::size_t ib = kb + 1; ib < blocks; ++ib) {
+			for (std::size_t jb = kb + 1; jb < blocks; ++jb) {
+				const std::size_t i0 = ib * block_size, i1 = std::min(i0 + block_size, n);
+				const std::size_t j0 = jb * block_size, j1 = std::min(j0 + block_size, n);
+
+				#pragma omp task depend(in: tile[ib * blocks + kb], tile[kb * blocks + jb]) depend(inout: tile[ib * blocks + jb])
+				for (std::size_t i = i0; i < i1; ++i)
+					for (std::size_t k = k0; k < k1; ++k)
+						lu_row_update(A, i, k, j0, j1);
+			}
+		}
+	}
+}
 
-	// initialize data
-	init_array(A.get_ref());
+// floating-point operations of kernel_lu
+constexpr double flop_count(std::size_t n) {
+	return 2.0 * (n - 1.0) * n * (n + 1.0) / 3 + n * (n - 1.0) / 2;
+}
+
+// compulsory memory traffic of kernel_lu in bytes (inputs read and outputs written once)
+constexpr double byte_count(std::size_t n) {
+	return sizeof(num_t) * 2.0 * n * n;
+}
+
+} // namespace
+
+int KERNEL_MAIN(int argc, char *argv[]) {
+	using namespace std::string_literals;
 
-	auto start = std::chrono::high_resolution_clock::now();
+	// benchmark parameters
+	polybench::params params(argc, argv);
 
-	// run kernel
-	kernel_lu(A.get_ref(), tuning.order);
+	// the sizes of the selected variant
+	if (tuning.tiled) {
+		polybench::require_tuning_size("block_size", tuning.block_size);
+	}
 
-	auto end = std::chrono::high_resolution_clock::now();
+	// problem size
+	std::size_t n = params.size("N", N);
 
-	auto duration = std::chrono::duration<long double>(end - start);
+	polybench::affinity affinity(params);
+	polybench::memory memory(params);
+
+	// data
+	auto A = memory.make_bag(noarr::scalar<num_t>() ^ tuning.a_layout ^ noarr::set_length<'i'>(n) ^ noarr::set_length<'j'>(n));
+
+	polybench::harness harness("lu", params);
+
+	harness
+		.length("n", n)
+		.tuning("order", tuning.order)
+		.tuning("a_layout", tuning.a_layout)
+		.tuning("tiled", tuning.tiled)
+		.tuning("block_size", tuning.block_size)
+		.environment(affinity.settings())
+		.environment(memory.settings())
+		.flops(flop_count(n))
+		.bytes(byte_count(n));
+
+	harness.run([&] {
+		// initialize data
+		init_array(A.get_ref());
+	}, [&] {
+		// run kernel
+		if (tuning.tiled)
+			kernel_lu_tiled(A.get_ref(), tuning.block_size);
+		else
+			kernel_lu(A.get_ref(), tuning.order);
+	});
 
 	// print results
+	polybench::results results(params);
+
 	if (argc > 0 && argv[0] != ""s) {
-		std::cout << std::fixed << std::setprecision(2);
-		noarr::serialize_data(std::cout, A.get_ref() ^ noarr::hoist<'i'>());
+		if (results.text()) {
+			std::cout << std::fixed << std::setprecision(2);
+			noarr::serialize_data(std::cout, A.get_ref() ^ noarr::hoist<'i'>());
+		}
+		else {
+			results.write<'i', 'j'>("A", A.get_ref());
+		}
 	}
 
-	std::cerr << std::fixed << std::setprecision(6);
-	std::cerr << duration.count() << std::endl;
+	harness.environment(memory.placement());
+	harness.report(std::cerr);
+	memory.report(std::cerr);
+
+	return 0;
 }
@@ -1,4 +1,3 @@
-#include <chrono>
 #include <cstddef>
 #include <iomanip>
 #include <iostream>
@@ -6,6 +5,11 @@
 #include <noarr/traversers.hpp>
 
 #include "defines.hpp"
+#include "params.hpp"
+#include "harness.hpp"
+#include "affinity.hpp"
+#include "memory.hpp"
+#include "results.hpp"
 #include "trisolv.hpp"
 
 using num_t = DATA_TYPE;
@@ -16,7 +20,11 @@ constexpr auto i_vec = noarr::vector<'i'>();
 constexpr auto j_vec = noarr::vector<'j'>();
 
 struct tuning {
+#ifdef TUNING_HEADER
+# include TUNING_HEADER
+#else
 	DEFINE_PROTO_STRUCT(l_layout, j_vec ^ i_vec);
+#endif
 } tuning;
 
 // initialization function
@@ -66,37 +74,69 @@ void kernel_trisolv(auto L, auto x, auto b) {
 	#pragma endscop
 }
 
-} // namespace
-
-int main(int argc, char *argv[]) {
-	using namespace std::string_literals;
+// floating-point operations of kernel_trisolv
+constexpr double flop_count(std::size_t n) {
+	return 1.0 * n * n;
+}
 
-	// problem size
-	std::size_t n = N;
+// compulsory memory traffic of kernel_trisolv in bytes (inputs read and outputs written once)
+constexpr double byte_count(std::size_t n) {
+	return sizeof(num_t) * (1.0 * n * n + 2.0 * n);
+}
 
-	// data
-	auto L = noarr::make_bag(noarr::scalar<num_t>() ^ tuning.l_layout ^ noarr::set_length<'i'>(n) ^ noarr::set_length<'j'>(n));
-	auto x = noarr::make_bag(noarr::scalar<num_t>() ^ noarr::vector<'i'>(n));
-	auto b = noarr::make_bag(noarr::scalar<num_t>() ^ noarr::vector<'i'>(n));
+} // namespace
 
-	// initialize data
-	init_array(L.get_ref(), x.get_ref(), b.get_ref());
+int KERNEL_MAIN(int argc, char *argv[]) {
+	using namespace std::string_literals;
 
-	auto start = std::chrono::high_resolution_clock::now();
+	// benchmark parameters
+	polybench::params params(argc, argv);
 
-	// run kernel
-	kernel_trisolv(L.get_ref(), x.get_ref(), b.get_ref());
+	// problem size
+	std::size_t n = params.size("N", N);
 
-	auto end = std::chrono::high_resolution_clock::now();
+	polybench::affinity affinity(params);
+	polybench::memory memory(params);
 
-	auto duration = std::chrono::duration<long double>(end - start);
+	// data
+	auto L = memory.make_bag(noarr::scalar<num_t>() ^ tuning.l_layout ^ noarr::set_length<'i'>(n) ^ noarr::set_length<'j'>(n));
+	auto x = memory.make_bag(noarr::scalar<num_t>() ^ noarr::vector<'i'>(n));
+	auto b = memory.make_bag(noarr::scalar<num_t>() ^ noarr::vector<'i'>(n));
+
+	polybench::harness harness("trisolv", params);
+
+	harness
+		.length("n", n)
+		.tuning("l_layout", tuning.l_layout)
+		.environment(affinity.settings())
+		.environment(memory.settings())
+		.flops(flop_count(n))
+		.bytes(byte_count(n));
+
+	harness.run([&] {
+		// initialize data
+		init_array(L.get_ref(), x.get_ref(), b.get_ref());
+	}, [&] {
+		// run kernel
+		kernel_trisolv(L.get_ref(), x.get_ref(), b.get_ref());
+	});
 
 	// print results
+	polybench::results results(params);
+
 	if (argc > 0 && argv[0] != ""s) {
-		std::cout << std::fixed << std::setprecision(2);
-		noarr::serialize_data(std::cout, x);
+		if (results.text()) {
+			std::cout << std::fixed << std::setprecision(2);
+			noarr::serialize_data(std::cout, x);
+		}
+		else {
+			results.write<'i'>("x", x.get_ref());
+		}
 	}
 
-	std::cerr << std::fixed << std::setprecision(6);
-	std::cerr << duration.count() << std::endl;
+	harness.environment(memory.placement());
+	harness.report(std::cerr);
+	memory.report(std::cerr);
+
+	return 0;
 }
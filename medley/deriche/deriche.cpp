@@ -1,11 +1,16 @@
+#include <algorithm>
 #include <cmath>
-#include <chrono>
 #include <iomanip>
 #include <iostream>
 
 #include <noarr/traversers.hpp>
 
 #include "defines.hpp"
+#include "params.hpp"
+#include "harness.hpp"
+#include "affinity.hpp"
+#include "memory.hpp"
+#include "results.hpp"
 #include "deriche.hpp"
 
 using num_t = DATA_TYPE;
@@ -16,11 +21,22 @@ constexpr auto w_vec = noarr::vector<'w'>();
 constexpr auto h_vec = noarr::vector<'h'>();
 
 struct tuning {
+#ifdef TUNING_HEADER
+# include TUNING_HEADER
+#else
 	DEFINE_PROTO_STRUCT(img_in_layout, h_vec ^ w_vec);
 	DEFINE_PROTO_STRUCT(img_out_layout, h_vec ^ w_vec);
 
 	DEFINE_PROTO_STRUCT(y1_layout, h_vec ^ w_vec);
 	DEFINE_PROTO_STRUCT(y2_layout, h_vec ^ w_vec);
+
+	// kernel_deriche_parallel: rows and strips of strip_size columns distributed among threads
+	AUTO_FIELD(parallel, false);
+	AUTO_FIELD(strip_size, (std::size_t)64);
+
+	// kernel_deriche_fused: like kernel_deriche_parallel, without the y1 and y2 images
+	AUTO_FIELD(fused, false);
+#endif
 } tuning;
 
 // initialization function
@@ -126,41 +142,338 @@ void kernel_deriche(num_t alpha, auto imgIn, auto imgOut, auto y1, auto y2) {
 	#pragma endscop
 }
 
-} // namespace
+// the coefficients of the filter, computed as in kernel_deriche
+struct deriche_coefficients {
+	num_t a1, a2, a3, a4, a5, a6, a7, a8, b1, b2, c1, c2;
 
-int main(int argc, char *argv[]) {
-	using namespace std::string_literals;
+	explicit deriche_coefficients(num_t alpha) {
+		num_t k = ((num_t)1.0 - std::exp(-alpha)) * ((num_t)1.0 - std::exp(-alpha)) / ((num_t)1.0 + (num_t)2.0 * alpha * std::exp(-alpha) - std::exp(((num_t)2.0 * alpha)));
+		a1 = a5 = k;
+		a2 = a6 = k * std::exp(-alpha) * (alpha - (num_t)1.0);
+		a3 = a7 = k * std::exp(-alpha) * (alpha + (num_t)1.0);
+		a4 = a8 = -k * std::exp(((num_t)(-2.0) * alpha));
+		b1 = std::pow((num_t)2.0, -alpha);
+		b2 = -std::exp(((num_t)(-2.0) * alpha));
+		c1 = c2 = 1;
+	}
+};
 
-	// problem size
-	std::size_t nw = NW;
-	std::size_t nh = NH;
+// multi-threaded computation kernel
+//
+// The horizontal passes run on whole rows (w) distributed among the threads,
+// the vertical passes on strips of strip_size columns (h), one column per SIMD
+// lane. Each combination is fused into the anti-causal pass preceding it.
+[[gnu::flatten, gnu::noinline]]
+void kernel_deriche_parallel(num_t alpha, auto imgIn, auto imgOut, auto y1, auto y2, std::size_t strip_size) {
+	// imgIn: w x h
+	// imgOut: w x h
+	// y1: w x h
+	// y2: w x h
+	using namespace noarr;
 
-	// data
-	num_t alpha;
-	auto imgIn = noarr::make_bag(noarr::scalar<num_t>() ^ tuning.img_in_layout ^ noarr::set_length<'w'>(nw) ^ noarr::set_length<'h'>(nh));
-	auto imgOut = noarr::make_bag(noarr::scalar<num_t>() ^ tuning.img_out_layout ^ noarr::set_length<'w'>(nw) ^ noarr::set_length<'h'>(nh));
+	const auto [a1, a2, a3, a4, a5, a6, a7, a8, b1, b2, c1, c2] = deriche_coefficients(alpha);
+
+	const std::size_t nw = imgIn | get_length<'w'>();
+	const std::size_t nh = imgIn | get_length<'h'>();
+
+	#pragma omp parallel
+	{
+		// horizontal passes
+		#pragma omp for schedule(static)
+		for (std::size_t w = 0; w < nw; ++w) {
+			num_t ym1 = 0;
+			num_t ym2 = 0;
+			num_t xm1 = 0;
+
+			for (std::size_t h = 0; h < nh; ++h) {
+				const auto state = idx<'w'>(w) & idx<'h'>(h);
+
+				y1[state] = a1 * imgIn[state] + a2 * xm1 + b1 * ym1 + b2 * ym2;
+				xm1 = imgIn[state];
+				ym2 = ym1;
+				ym1 = y1[state];
+			}
+
+			num_t yp1 = 0;
+			num_t yp2 = 0;
+			num_t xp1 = 0;
+			num_t xp2 = 0;
+
+			for (std::size_t h = nh; h-- > 0;) {
+				const auto state = idx<'w'>(w) & idx<'h'>(h);
+
+				y2[state] = a3 * xp1 + a4 * xp2 + b1 * yp1 + b2 * yp2;
+				xp2 = xp1;
+				xp1 = imgIn[state];
+				yp2 = yp1;
+				yp1 = y2[state];
+
+				imgOut[state] = c1 * (y1[state] + y2[state]);
+			}
+		}
+
+		// the recurrence state of the lanes: the previous inputs (t1, t2) and outputs (z1, z2)
+		auto t1_bag = make_bag(scalar<num_t>() ^ vector<'l'>(strip_size));
+		auto t2_bag = make_bag(scalar<num_t>() ^ vector<'l'>(strip_size));
+		auto z1_bag = make_bag(scalar<num_t>() ^ vector<'l'>(strip_size));
+		auto z2_bag = make_bag(scalar<num_t>() ^ vector<'l'>(strip_size));
+
+		auto t1 = t1_bag.get_ref();
+		auto t2 = t2_bag.get_ref();
+		auto z1 = z1_bag.get_ref();
+		auto z2 = z2_bag.get_ref();
+
+		// vertical passes
+		#pragma omp for schedule(static)
+		for (std::size_t h0 = 0; h0 < nh; h0 += strip_size) {
+			const std::size_t lanes = std::min(strip_size, nh - h0);
+
+			#pragma omp simd
+			for (std::size_t l = 0; l < lanes; ++l)
+				t1[idx<'l'>(l)] = z1[idx<'l'>(l)] = z2[idx<'l'>(l)] = 0;
+
+			for (std::size_t w = 0; w < nw; ++w) {
+				#pragma omp simd
+				for (std::size_t l = 0; l < lanes; ++l) {
+					const auto state = idx<'w'>(w) & idx<'h'>(h0 + l);
+
+					y1[state] = a5 * imgOut[state] + a6 * t1[idx<'l'>(l)] + b1 * z1[idx<'l'>(l)] + b2 * z2[idx<'l'>(l)];
+					t1[idx<'l'>(l)] = imgOut[state];
+					z2[idx<'l'>(l)] = z1[idx<'l'>(l)];
+					z1[idx<'l'>(l)] = y1[state];
+				}
+			}
+
+			#pragma omp simd
+			for (std::size_t l = 0; l < lanes; ++l)
+				t1[idx<'l'>(l)] = t2[idx<'l'>(l)] = z1[idx<'l'>(l)] = z2[idx<'l'>(l)] = 0;
+
+			for (std::size_t w = nw; w-- > 0;) {
+				#pragma omp simd
+				for (std::size_t l = 0; l < lanes; ++l) {
+					const auto state = idx<'w'>(w) & idx<'h'>(h0 + l);
+
+					y2[state] = a7 * t1[idx<'l'>(l)] + a8 * t2[idx<'l'>(l)] + b1 * z1[idx<'l'>(l)] + b2 * z2[idx<'l'>(l)];
+					t2[idx<'l'>(l)] = t1[idx<'l'>(l)];
+					t1[idx<'l'>(l)] = imgOut[state];
+					z2[idx<'l'>(l)] = z1[idx<'l'>(l)];
+					z1[idx<'l'>(l)] = y2[state];
+
+					imgOut[state] = c2 * (y1[state] + y2[state]);
+				}
+			}
+		}
+	}
+}
 
-	auto y1 = noarr::make_bag(noarr::scalar<num_t>() ^ tuning.y1_layout ^ noarr::set_length<'w'>(nw) ^ noarr::set_length<'h'>(nh));
-	auto y2 = noarr::make_bag(noarr::scalar<num_t>() ^ tuning.y2_layout ^ noarr::set_length<'w'>(nw) ^ noarr::set_length<'h'>(nh));
+// multi-threaded computation kernel without the intermediate images
+//
+// Like kernel_deriche_parallel, but the causal pass of a row (or of a strip of
+// columns) goes to a buffer private to the thread and the anti-causal pass
+// keeps its outputs in registers, writing only the combined result to imgOut.
+[[gnu::flatten, gnu::noinline]]
+void kernel_deriche_fused(num_t alpha, auto imgIn, auto imgOut, std::size_t strip_size) {
+	// imgIn: w x h
+	// imgOut: w x h
+	using namespace noarr;
+
+	const auto [a1, a2, a3, a4, a5, a6, a7, a8, b1, b2, c1, c2] = deriche_coefficients(alpha);
+
+	const std::size_t nw = imgIn | get_length<'w'>();
+	const std::size_t nh = imgIn | get_length<'h'>();
+
+	#pragma omp parallel
+	{
+		// row: h (the causal pass of a row)
+		auto row_bag = make_bag(scalar<num_t>() ^ vector<'h'>(nh));
+		auto row = row_bag.get_ref();
+
+		// horizontal passes
+		#pragma omp for schedule(static)
+		for (std::size_t w = 0; w < nw; ++w) {
+			num_t ym1 = 0;
+			num_t ym2 = 0;
+			num_t xm1 = 0;
+
+			for (std::size_t h = 0; h < nh; ++h) {
+				const auto state = idx<'w'>(w) & idx<'h'>(h);
+
+				row[state] = a1 * imgIn[state] + a2 * xm1 + b1 * ym1 + b2 * ym2;
+				xm1 = imgIn[state];
+				ym2 = ym1;
+				ym1 = row[state];
+			}
+
+			num_t yp1 = 0;
+			num_t yp2 = 0;
+			num_t xp1 = 0;
+			num_t xp2 = 0;
+
+			for (std::size_t h = nh; h-- > 0;) {
+				const auto state = idx<'w'>(w) & idx<'h'>(h);
+
+				const num_t y2 = a3 * xp1 + a4 * xp2 + b1 * yp1 + b2 * yp2;
+				xp2 = xp1;
+				xp1 = imgIn[state];
+				yp2 = yp1;
+				yp1 = y2;
+
+				imgOut[state] = c1 * (row[state] + y2);
+			}
+		}
+
+		// strip: l x w (the causal pass of a strip of columns)
+		auto strip_bag = make_bag(scalar<num_t>() ^ vector<'l'>(strip_size) ^ vector<'w'>(nw));
+		auto strip = strip_bag.get_ref();
+
+		// the recurrence state of the lanes: the previous inputs (t1, t2) and outputs (z1, z2)
+		auto t1_bag = make_bag(scalar<num_t>() ^ vector<'l'>(strip_size));
+		auto t2_bag = make_bag(scalar<num_t>() ^ vector<'l'>(strip_size));
+		auto z1_bag = make_bag(scalar<num_t>() ^ vector<'l'>(strip_size));
+		auto z2_bag = make_bag(scalar<num_t>() ^ vector<'l'>(strip_size));
+
+		auto t1 = t1_bag.get_ref();
+		auto t2 = t2_bag.get_ref();
+		auto z1 = z1_bag.get_ref();
+		auto z2 = z2_bag.get_ref();
+
+		// vertical passes
+		#pragma omp for schedule(static)
+		for (std::size_t h0 = 0; h0 < nh; h0 += strip_size) {
+			const std::size_t lanes = std::min(strip_size, nh - h0);
+
+			#pragma omp simd
+			for (std::size_t l = 0; l < lanes; ++l)
+				t1[idx<'l'>(l)] = z1[idx<'l'>(l)] = z2[idx<'l'>(l)] = 0;
+
+			for (std::size_t w = 0; w < nw; ++w) {
+				#pragma omp simd
+				for (std::size_t l = 0; l < lanes; ++l) {
+					const auto state = idx<'w'>(w) & idx<'h'>(h0 + l);
+					const auto lane = idx<'w'>(w) & idx<'l'>(l);
+
+					strip[lane] = a5 * imgOut[state] + a6 * t1[idx<'l'>(l)] + b1 * z1[idx<'l'>(l)] + b2 * z2[idx<'l'>(l)];
+					t1[idx<'l'>(l)] = imgOut[state];
+					z2[idx<'l'>(l)] = z1[idx<'l'>(l)];
+					z1[idx<'l'>(l)] = strip[lane];
+				}
+			}
+
+			#pragma omp simd
+			for (std::size_t l = 0; l < lanes; ++l)
+				t1[idx<'l'>(l)] = t2[idx<'l'>(l)] = z1[idx<'l'>(l)] = z2[idx<'l'>(l)] = 0;
+
+			for (std::size_t w = nw; w-- > 0;) {
+				#pragma omp simd
+				for (std::size_t l = 0; l < lanes; ++l) {
+					const auto state = idx<'w'>(w) & idx<'h'>(h0 + l);
+					const auto lane = idx<'w'>(w) & idx<'l'>(l);
+
+					const num_t y2 = a7 * t1[idx<'l'>(l)] + a8 * t2[idx<'l'>(l)] + b1 * z1[idx<'l'>(l)] + b2 * z2[idx<'l'>(l)];
+					t2[idx<'l'>(l)] = t1[idx<'l'>(l)];
+					t1[idx<'l'>(l)] = imgOut[state];
+					z2[idx<'l'>(l)] = z1[idx<'l'>(l)];
+					z1[idx<'l'>(l)] = y2;
+
+					imgOut[state] = c2 * (strip[lane] + y2);
+				}
+			}
+		}
+	}
+}
+
+// floating-point operations of kernel_deriche
+constexpr double flop_count(std::size_t nw, std::size_t nh) {
+	return 32.0 * nw * nh;
+}
+
+// compulsory memory traffic of kernel_deriche in bytes (inputs read and outputs written once)
+constexpr double byte_count(std::size_t nw, std::size_t nh) {
+	return sizeof(num_t) * 2.0 * nw * nh;
+}
+
+} // namespace
 
-	// initialize data
-	init_array(alpha, imgIn.get_ref(), imgOut.get_ref());
+int KERNEL_MAIN(int argc, char *argv[]) {
+	using namespace std::string_literals;
 
-	auto start = std::chrono::high_resolution_clock::now();
+	// benchmark parameters
+	polybench::params params(argc, argv);
 
-	// run kernel
-	kernel_deriche(alpha, imgIn.get_ref(), imgOut.get_ref(), y1.get_ref(), y2.get_ref());
+	// the sizes of the selected variant
+	if (tuning.parallel || tuning.fused) {
+		polybench::require_tuning_size("strip_size", tuning.strip_size);
+	}
 
-	auto end = std::chrono::high_resolution_clock::now();
+	// problem size
+	std::size_t nw = params.size("NW", NW);
+	std::size_t nh = params.size("NH", NH);
 
-	auto duration = std::chrono::duration<long double>(end - start);
+	polybench::affinity affinity(params);
+	polybench::memory memory(params);
+
+	// data (partitioned into the rows of the horizontal passes of the parallel variants, which touch them first)
+	num_t alpha;
+	auto imgIn = memory.make_bag(noarr::scalar<num_t>() ^ tuning.img_in_layout ^ noarr::set_length<'w'>(nw) ^ noarr::set_length<'h'>(nh),
+		polybench::partition<'w'>{});
+	auto imgOut = memory.make_bag(noarr::scalar<num_t>() ^ tuning.img_out_layout ^ noarr::set_length<'w'>(nw) ^ noarr::set_length<'h'>(nh),
+		polybench::partition<'w'>{});
+
+	// the intermediate images (not used by kernel_deriche_fused)
+	std::size_t nw_y = tuning.fused ? 0 : nw;
+	std::size_t nh_y = tuning.fused ? 0 : nh;
+
+	auto y1 = memory.make_bag(noarr::scalar<num_t>() ^ tuning.y1_layout ^ noarr::set_length<'w'>(nw_y) ^ noarr::set_length<'h'>(nh_y),
+		polybench::partition<'w'>{});
+	auto y2 = memory.make_bag(noarr::scalar<num_t>() ^ tuning.y2_layout ^ noarr::set_length<'w'>(nw_y) ^ noarr::set_length<'h'>(nh_y),
+		polybench::partition<'w'>{});
+
+	polybench::harness harness("deriche", params);
+
+	harness
+		.length("nw", nw)
+		.length("nh", nh)
+		.tuning("img_in_layout", tuning.img_in_layout)
+		.tuning("img_out_layout", tuning.img_out_layout)
+		.tuning("y1_layout", tuning.y1_layout)
+		.tuning("y2_layout", tuning.y2_layout)
+		.tuning("parallel", tuning.parallel)
+		.tuning("strip_size", tuning.strip_size)
+		.tuning("fused", tuning.fused)
+		.environment(affinity.settings())
+		.environment(memory.settings())
+		.flops(flop_count(nw, nh))
+		.bytes(byte_count(nw, nh));
+
+	harness.run([&] {
+		// initialize data
+		init_array(alpha, imgIn.get_ref(), imgOut.get_ref());
+	}, [&] {
+		// run kernel
+		if (tuning.fused)
+			kernel_deriche_fused(alpha, imgIn.get_ref(), imgOut.get_ref(), tuning.strip_size);
+		else if (tuning.parallel)
+			kernel_deriche_parallel(alpha, imgIn.get_ref(), imgOut.get_ref(), y1.get_ref(), y2.get_ref(), tuning.strip_size);
+		else
+			kernel_deriche(alpha, imgIn.get_ref(), imgOut.get_ref(), y1.get_ref(), y2.get_ref());
+	});
 
 	// print results
+	polybench::results results(params);
+
 	if (argc > 0 && argv[0] != ""s) {
-		std::cout << std::fixed << std::setprecision(2);
-		noarr::serialize_data(std::cout, imgOut.get_ref() ^ noarr::hoist<'w'>());
+		if (results.text()) {
+			std::cout << std::fixed << std::setprecision(2);
+			noarr::serialize_data(std::cout, imgOut.get_ref() ^ noarr::hoist<'w'>());
+		}
+		else {
+			results.write<'w', 'h'>("imgOut", imgOut.get_ref());
+		}
 	}
 
-	std::cerr << std::fixed << std::setprecision(6);
-	std::cerr << duration.count() << std::endl;
+	harness.environment(memory.placement());
+	harness.report(std::cerr);
+	memory.report(std::cerr);
+
+	return 0;
 }
@@ -1,11 +1,15 @@
 #include <algorithm>
-#include <chrono>
 #include <iomanip>
 #include <iostream>
 
 #include <noarr/traversers.hpp>
 
 #include "defines.hpp"
+#include "params.hpp"
+#include "harness.hpp"
+#include "affinity.hpp"
+#include "memory.hpp"
+#include "results.hpp"
 #include "floyd-warshall.hpp"
 
 using num_t = DATA_TYPE;
@@ -17,6 +21,9 @@ constexpr auto j_vec = noarr::vector<'j'>();
 constexpr auto k_vec = noarr::vector<'k'>();
 
 struct tuning {
+#ifdef TUNING_HEADER
+# include TUNING_HEADER
+#else
 	DEFINE_PROTO_STRUCT(block_i, noarr::hoist<'i'>());
 	DEFINE_PROTO_STRUCT(block_j, noarr::hoist<'j'>());
 	DEFINE_PROTO_STRUCT(block_k, noarr::hoist<'k'>());
@@ -24,6 +31,11 @@ struct tuning {
 	DEFINE_PROTO_STRUCT(order, block_j ^ block_i ^ block_k);
 
 	DEFINE_PROTO_STRUCT(path_layout, j_vec ^ i_vec);
+
+	// kernel_floyd_warshall_blocked: tiles of block_size x block_size, processed in three phases
+	AUTO_FIELD(blocked, false);
+	AUTO_FIELD(block_size, (std::size_t)64);
+#endif
 } tuning;
 
 // initialization function
@@ -60,35 +72,150 @@ void kernel_floyd_warshall(auto path, Order order = {}) {
 	#pragma endscop
 }
 
-} // namespace
+// relaxes the paths from [i0, i1) to [j0, j1) through the vertices [k0, k1)
+[[gnu::always_inline]]
+inline void floyd_warshall_tile(auto path,
+	std::size_t k0, std::size_t k1, std::size_t i0, std::size_t i1, std::size_t j0, std::size_t j1) {
+	// path: i x j
+	using namespace noarr;
 
-int main(int argc, char *argv[]) {
-	using namespace std::string_literals;
+	for (std::size_t k = k0; k < k1; ++k) {
+		for (std::size_t i = i0; i < i1; ++i) {
+			const num_t path_ik = path[idx<'i'>(i) & idx<'j'>(k)];
 
-	// problem size
-	std::size_t n = N;
+			#pragma omp simd
+			for (std::size_t j = j0; j < j1; ++j)
+				path[idx<'i'>(i) & idx<'j'>(j)] =
+					std::min(path[idx<'i'>(k) & idx<'j'>(j)] + path_ik, path[idx<'i'>(i) & idx<'j'>(j)]);
+		}
+	}
+}
+
+// blocked multi-threaded computation kernel
+//
+// For each diagonal tile: the tile itself, then the tiles of its row and column
+// (in parallel), then all the remaining tiles (in parallel). The shortest paths
+// are the same as those computed by kernel_floyd_warshall.
+[[gnu::flatten, gnu::noinline]]
+void kernel_floyd_warshall_blocked(auto path, std::size_t block_size) {
+	// path: i x j
+	using namespace noarr;
+
+	const std::size_t n = path | get_length<'i'>();
+	const std::size_t blocks = (n + block_size - 1) / block_size;
+
+	#pragma omp parallel
+	for (std::size_t kb = 0; kb < blocks; ++kb) {
+		const std::size_t k0 = kb * block_size, k1 = std::min(k0 + block_size, n);
+
+		// phase 1: the diagonal tile
+		#pragma omp single
+		floyd_warshall_tile(path, k0, k1, k0, k1, k0, k1);
+
+		// phase 2: the row and the column of the diagonal tile
+		#pragma omp for schedule(dynamic)
+		for (std::size_t b = 0; b < blocks; ++b) {
+			if (b == kb)
+				continue;
 
-	// data
-	auto path = noarr::make_bag(noarr::scalar<num_t>() ^ tuning.path_layout ^ noarr::set_length<'i'>(n) ^ noarr::set_length<'j'>(n));
+			const std::size_t b0 = b * block_size, b1 = std::min(b0 + block_size, n);
 
-	// initialize data
-	init_array(path.get_ref());
+			floyd_warshall_tile(path, k0, k1, k0, k1, b0, b1);
+			floyd_warshall_tile(path, k0, k1, b0, b1, k0, k1);
+		}
 
-	auto start = std::chrono::high_resolution_clock::now();
+		// phase 3: the remaining tiles
+		#pragma omp for collapse(2) schedule(static)
+		for (std::size_t ib = 0; ib < blocks; ++ib) {
+			for (std::size_t jb = 0; jb < blocks; ++jb) {
+				if (ib == kb || jb == kb)
+					continue;
 
-	// run kernel
-	kernel_floyd_warshall(path.get_ref(), tuning.order);
+				const std::size_t i0 = ib * block_size, i1 = std::min(i0 + block_size, n);
+				const std::size_t j0 = jb * block_size, j1 = std::min(j0 + block_size, n);
 
-	auto end = std::chrono::high_resolution_clock::now();
+				floyd_warshall_tile(path, k0, k1, i0, i1, j0, j1);
+			}
+		}
+	}
+}
+
+// floating-point operations of kernel_floyd_warshall
+constexpr double flop_count(std::size_t n) {
+	return 2.0 * n * n * n;
+}
+
+// compulsory memory traffic of kernel_floyd_warshall in bytes (inputs read and outputs written once)
+constexpr double byte_count(std::size_t n) {
+	return sizeof(num_t) * 2.0 * n * n;
+}
+
+} // namespace
 
-	auto duration = std::chrono::duration<long double>(end - start);
+int KERNEL_MAIN(int argc, char *argv[]) {
+	using namespace std::string_literals;
+
+	// benchmark parameters
+	polybench::params params(argc, argv);
+
+	// the sizes of the selected variant
+	if (tuning.blocked) {
+		polybench::require_tuning_size("block_size", tuning.block_size);
+	}
+
+	// problem size
+	std::size_t n = params.size("N", N);
+
+	polybench::affinity affinity(params);
+	polybench::memory memory(params);
+
+	// data (partitioned into the rows of tiles of kernel_floyd_warshall_blocked)
+	auto path = memory.make_bag(noarr::scalar<num_t>() ^ tuning.path_layout ^ noarr::set_length<'i'>(n) ^ noarr::set_length<'j'>(n),
+		polybench::partition<'i'>{tuning.block_size});
+
+	polybench::harness harness("floyd-warshall", params);
+
+	harness
+		.length("n", n)
+		.tuning("block_i", tuning.block_i)
+		.tuning("block_j", tuning.block_j)
+		.tuning("block_k", tuning.block_k)
+		.tuning("order", tuning.order)
+		.tuning("path_layout", tuning.path_layout)
+		.tuning("blocked", tuning.blocked)
+		.tuning("block_size", tuning.block_size)
+		.environment(affinity.settings())
+		.environment(memory.settings())
+		.flops(flop_count(n))
+		.bytes(byte_count(n));
+
+	harness.run([&] {
+		// initialize data
+		init_array(path.get_ref());
+	}, [&] {
+		// run kernel
+		if (tuning.blocked)
+			kernel_floyd_warshall_blocked(path.get_ref(), tuning.block_size);
+		else
+			kernel_floyd_warshall(path.get_ref(), tuning.order);
+	});
 
 	// print results
+	polybench::results results(params);
+
 	if (argc > 0 && argv[0] != ""s) {
-		std::cout << std::fixed << std::setprecision(2);
-		noarr::serialize_data(std::cout, path.get_ref() ^ noarr::hoist<'i'>());
+		if (results.text()) {
+			std::cout << std::fixed << std::setprecision(2);
+			noarr::serialize_data(std::cout, path.get_ref() ^ noarr::hoist<'i'>());
+		}
+		else {
+			results.write<'i', 'j'>("path", path.get_ref());
+		}
 	}
 
-	std::cerr << std::fixed << std::setprecision(6);
-	std::cerr << duration.count() << std::endl;
+	harness.environment(memory.placement());
+	harness.report(std::cerr);
+	memory.report(std::cerr);
+
+	return 0;
 }
@@ -1,11 +1,15 @@
 #include <algorithm>
-#include <chrono>
 #include <iomanip>
 #include <iostream>
 
 #include <noarr/traversers.hpp>
 
 #include "defines.hpp"
+#include "params.hpp"
+#include "harness.hpp"
+#include "affinity.hpp"
+#include "memory.hpp"
+#include "results.hpp"
 #include "nussinov.hpp"
 
 using num_t = DATA_TYPE;
@@ -20,7 +24,14 @@ constexpr auto i_vec = noarr::vector<'i'>();
 constexpr auto j_vec = noarr::vector<'j'>();
 
 struct tuning {
+#ifdef TUNING_HEADER
+# include TUNING_HEADER
+#else
 	DEFINE_PROTO_STRUCT(table_layout, j_vec ^ i_vec);
+
+	// kernel_nussinov_wavefront: anti-diagonals computed in parallel, using a transposed copy of the table
+	AUTO_FIELD(wavefront, false);
+#endif
 } tuning;
 
 // initialization function
@@ -91,41 +102,131 @@ void kernel_nussinov(auto seq, auto table) {
 	#pragma endscop
 }
 
-} // namespace
+// wavefront multi-threaded computation kernel
+//
+// The cells of an anti-diagonal (j - i constant) depend only on the cells of the
+// preceding anti-diagonals, so each anti-diagonal is computed in parallel.
+// table_t holds the table transposed (table[i, j] at table_t[j, i]), so both
+// operands of the k-reduction are read along a row of the default layout.
+[[gnu::flatten, gnu::noinline]]
+void kernel_nussinov_wavefront(auto seq, auto table, auto table_t) {
+	// seq: i
+	// table: i x j
+	// table_t: i x j
+	using namespace noarr;
 
-int main(int argc, char *argv[]) {
-	using namespace std::string_literals;
+	const std::size_t n = table | get_length<'i'>();
 
-	// problem size
-	std::size_t n = N;
+	traverser(table) | [=](auto state) {
+		auto [i, j] = get_indices<'i', 'j'>(state);
+		table_t[idx<'i'>(j) & idx<'j'>(i)] = table[state];
+	};
 
-	// data
-	auto seq = noarr::make_bag(noarr::scalar<base_t>() ^ noarr::vector<'i'>(n));
-	auto table = noarr::make_bag(noarr::scalar<num_t>() ^ tuning.table_layout ^ noarr::set_length<'i'>(n) ^ noarr::set_length<'j'>(n));
+	#pragma omp parallel
+	for (std::size_t d = 1; d < n; ++d) {
+		#pragma omp for schedule(static)
+		for (std::size_t i = 0; i < n - d; ++i) {
+			const std::size_t j = i + d;
+
+			num_t score = table[idx<'i'>(i) & idx<'j'>(j)];
+
+			score = max_score(score, table[idx<'i'>(i) & idx<'j'>(j - 1)]);
+			score = max_score(score, table[idx<'i'>(i + 1) & idx<'j'>(j)]);
+
+			if (i < j - 1)
+				score = max_score(score,
+					table[idx<'i'>(i + 1) & idx<'j'>(j - 1)] +
+					match(seq[idx<'i'>(i)], seq[idx<'i'>(j)]));
+			else
+				score = max_score(score, table[idx<'i'>(i + 1) & idx<'j'>(j - 1)]);
+
+			#pragma omp simd reduction(max:score)
+			for (std::size_t k = i + 1; k < j; ++k)
+				score = max_score(score,
+					table[idx<'i'>(i) & idx<'j'>(k)] +
+					table_t[idx<'i'>(j) & idx<'j'>(k + 1)]);
+
+			table[idx<'i'>(i) & idx<'j'>(j)] = score;
+			table_t[idx<'i'>(j) & idx<'j'>(i)] = score;
+		}
+	}
+}
 
-	// initialize data
-	init_array(seq.get_ref(), table.get_ref());
+// floating-point operations of kernel_nussinov
+constexpr double flop_count(std::size_t n) {
+	return n * (n - 1.0) * (n - 2.0) / 3 + 2.0 * n * (n - 1.0);
+}
 
-	auto start = std::chrono::high_resolution_clock::now();
+// compulsory memory traffic of kernel_nussinov in bytes (inputs read and outputs written once)
+constexpr double byte_count(std::size_t n) {
+	return sizeof(num_t) * 2.0 * n * n + sizeof(base_t) * n;
+}
+
+} // namespace
+
+int KERNEL_MAIN(int argc, char *argv[]) {
+	using namespace std::string_literals;
+
+	// benchmark parameters
+	polybench::params params(argc, argv);
 
-	// run kernel
-	kernel_nussinov(seq.get_ref(), table.get_ref());
+	// problem size
+	std::size_t n = params.size("N", N);
 
-	auto end = std::chrono::high_resolution_clock::now();
+	polybench::affinity affinity(params);
+	polybench::memory memory(params);
 
-	auto duration = std::chrono::duration<long double>(end - start);
+	// data
+	auto seq = memory.make_bag(noarr::scalar<base_t>() ^ noarr::vector<'i'>(n));
+	auto table = memory.make_bag(noarr::scalar<num_t>() ^ tuning.table_layout ^ noarr::set_length<'i'>(n) ^ noarr::set_length<'j'>(n));
+
+	// the transposed copy of the table used by kernel_nussinov_wavefront
+	std::size_t nt = tuning.wavefront ? n : 0;
+	auto table_t = memory.make_bag(noarr::scalar<num_t>() ^ tuning.table_layout ^ noarr::set_length<'i'>(nt) ^ noarr::set_length<'j'>(nt));
+
+	polybench::harness harness("nussinov", params);
+
+	harness
+		.length("n", n)
+		.tuning("table_layout", tuning.table_layout)
+		.tuning("wavefront", tuning.wavefront)
+		.environment(affinity.settings())
+		.environment(memory.settings())
+		.flops(flop_count(n))
+		.bytes(byte_count(n));
+
+	harness.run([&] {
+		// initialize data
+		init_array(seq.get_ref(), table.get_ref());
+	}, [&] {
+		// run kernel
+		if (tuning.wavefront)
+			kernel_nussinov_wavefront(seq.get_ref(), table.get_ref(), table_t.get_ref());
+		else
+			kernel_nussinov(seq.get_ref(), table.get_ref());
+	});
 
 	// print results
-	if (argc > 0 && argv[0] != ""s) [table = table.get_ref()] {
-		std::cout << std::fixed << std::setprecision(2);
-		noarr::traverser(table) | noarr::for_dims<'i'>([=](auto inner) {
+	polybench::results results(params);
+
+	if (argc > 0 && argv[0] != ""s) {
+		if (results.text()) [table = table.get_ref()] {
 			std::cout << std::fixed << std::setprecision(2);
-			inner ^ noarr::shift<'j'>(noarr::get_index<'i'>(inner)) | noarr::for_each<'j'>([=](auto state) {
-				std::cout << table[state] << " ";
+			noarr::traverser(table) | noarr::for_dims<'i'>([=](auto inner) {
+				std::cout << std::fixed << std::setprecision(2);
+				inner ^ noarr::shift<'j'>(noarr::get_index<'i'>(inner)) | noarr::for_each<'j'>([=](auto state) {
+					std::cout << table[state] << " ";
+				});
 			});
-		});
-	}();
+		}();
+		else {
+			results.write<'i', 'j'>("table", table.get_ref());
+		}
+	}
+
+	harness.environment(memory.placement());
+	harness.report(std::cerr);
+	memory.report(std::cerr);
 
-	std::cerr << std::fixed << std::setprecision(6);
-	std::cerr << duration.count() << std::endl;
+	return 0;
 }
@@ -4,11 +4,19 @@ prefix="$1"
 file="$2"
 
 NUM_RUNS=${NUM_RUNS:-10}
+BASELINE_CPU=${BASELINE_CPU:-}
+
+# the single-threaded baseline is pinned to the CPU of the main thread of the Noarr implementation
+# (see run_noarr_algorithm.sh), unpinned if the Noarr implementation is not pinned
+pin=()
+if [ -n "$BASELINE_CPU" ] && command -v taskset > /dev/null; then
+    pin=(taskset -c "$BASELINE_CPU")
+fi
 
 printf "\t%s: " $prefix
-"$file" 2>/dev/null
+"${pin[@]}" "$file" 2>/dev/null
 
 for _ in $(seq "$NUM_RUNS"); do
     printf "\t%s: " $prefix
-    "$file" 2>/dev/null
+    "${pin[@]}" "$file" 2>/dev/null
 done
@@ -4,9 +4,32 @@ prefix="$1"
 file="$2"
 
 NUM_RUNS=${NUM_RUNS:-10}
+IN_PROCESS=${IN_PROCESS:-0}
+CPU_FILE=${CPU_FILE:-}
+
+# runs the kernel with the given environment; the first run also writes the CPU of its main thread
+# (if it is pinned, see include/affinity.hpp) to $CPU_FILE, for pinning the baseline to the same CPU
+first_run() {
+    if [ -z "$CPU_FILE" ]; then
+        env "$@" "$file" 2>&1 1>/dev/null
+        return
+    fi
+
+    output=$(env POLYBENCH_AFFINITY_REPORT=on "$@" "$file" 2>&1 1>/dev/null)
+
+    printf "%s\n" "$output" | sed -n 's/^affinity: thread 0 -> cpu //p' > "$CPU_FILE"
+    printf "%s\n" "$output" | grep -v '^affinity: thread '
+}
+
+# repeat the measurement within a single process (one warmup run included)
+if [ "$IN_PROCESS" -eq 1 ]; then
+    printf "\t%s: " $prefix
+    first_run POLYBENCH_RUNS="$NUM_RUNS" POLYBENCH_WARMUP=1
+    exit
+fi
 
 printf "\t%s: " $prefix
-"$file" 2>&1 1>/dev/null
+first_run
 
 for _ in $(seq "$NUM_RUNS"); do
     printf "\t%s: " $prefix
@@ -1,10 +1,15 @@
-#include <chrono>
+#include <algorithm>
 #include <iomanip>
 #include <iostream>
 
 #include <noarr/traversers.hpp>
 
 #include "defines.hpp"
+#include "params.hpp"
+#include "harness.hpp"
+#include "affinity.hpp"
+#include "memory.hpp"
+#include "results.hpp"
 #include "adi.hpp"
 
 using num_t = DATA_TYPE;
@@ -15,10 +20,18 @@ constexpr auto i_vec = noarr::vector<'i'>();
 constexpr auto j_vec = noarr::vector<'j'>();
 
 struct tuning {
+#ifdef TUNING_HEADER
+# include TUNING_HEADER
+#else
 	DEFINE_PROTO_STRUCT(u_layout, j_vec ^ i_vec);
 	DEFINE_PROTO_STRUCT(v_layout, i_vec ^ j_vec);
 	DEFINE_PROTO_STRUCT(p_layout, j_vec ^ i_vec);
 	DEFINE_PROTO_STRUCT(q_layout, j_vec ^ i_vec);
+
+	// kernel_adi_batched: tridiagonal systems solved batch_size at a time, one per SIMD lane
+	AUTO_FIELD(batched, false);
+	AUTO_FIELD(batch_size, (std::size_t)16);
+#endif
 } tuning;
 
 // initialization function
@@ -118,39 +131,230 @@ void kernel_adi(auto tsteps, auto u, auto v, auto p, auto q) {
 	#pragma endscop
 }
 
-} // namespace
+// batched multi-threaded computation kernel
+//
+// The threads split the systems (i) of each sweep into batches of batch_size;
+// the Thomas recurrence along j advances all systems of a batch together, with
+// one system per SIMD lane. The p and q scratch of a batch is private to the
+// thread and stores the systems next to each other, as does v in the default
+// layout, so the lanes of the column sweep access contiguous memory. The row
+// sweep would access u and v across their rows; it transposes the rows of v
+// it reads and the rows of u it writes through lane-major buffers of the thread
+// instead, so its recurrences also run on contiguous memory.
+[[gnu::flatten, gnu::noinline]]
+void kernel_adi_batched(std::size_t tsteps, auto u, auto v, std::size_t batch_size) {
+	// u: i x j
+	// v: j x i
+	using namespace noarr;
 
-int main(int argc, char *argv[]) {
-	using namespace std::string_literals;
+	const std::size_t n = u | get_length<'i'>();
 
-	// problem size
-	std::size_t n = N;
-	std::size_t t = TSTEPS;
+	// no interior points (the sweeps of kernel_adi are empty as well)
+	if (n < 3)
+		return;
 
-	// data
-	auto u = noarr::make_bag(noarr::scalar<num_t>() ^ tuning.u_layout ^ noarr::set_length<'i'>(n) ^ noarr::set_length<'j'>(n)); 
-	auto v = noarr::make_bag(noarr::scalar<num_t>() ^ tuning.v_layout ^ noarr::set_length<'i'>(n) ^ noarr::set_length<'j'>(n));
-	auto p = noarr::make_bag(noarr::scalar<num_t>() ^ tuning.p_layout ^ noarr::set_length<'i'>(n) ^ noarr::set_length<'j'>(n));
-	auto q = noarr::make_bag(noarr::scalar<num_t>() ^ tuning.q_layout ^ noarr::set_length<'i'>(n) ^ noarr::set_length<'j'>(n));
+	num_t DX = (num_t)1.0 / (u | get_length<'i'>());
+	num_t DY = (num_t)1.0 / (u | get_length<'j'>());
+	num_t DT = (num_t)1.0 / tsteps;
 
-	// initialize data
-	init_array(u.get_ref());
+	num_t B1 = 2.0;
+	num_t B2 = 1.0;
 
-	auto start = std::chrono::high_resolution_clock::now();
+	num_t mul1 = B1 * DT / (DX * DX);
+	num_t mul2 = B2 * DT / (DY * DY);
 
-	// run kernel
-	kernel_adi(t, u.get_ref(), v.get_ref(), p.get_ref(), q.get_ref());
+	num_t a = -mul1 / (num_t)2.0;
+	num_t b = (num_t)1.0 + mul1;
+	num_t c = a;
 
-	auto end = std::chrono::high_resolution_clock::now();
+	num_t d = -mul2 / (num_t)2.0;
+	num_t e = (num_t)1.0 + mul2;
+	num_t f = d;
+
+	#pragma omp parallel
+	{
+		// p, q: l x j (the l-th system of the batch)
+		auto p_bag = make_bag(scalar<num_t>() ^ vector<'l'>(batch_size) ^ vector<'j'>(n));
+		auto q_bag = make_bag(scalar<num_t>() ^ vector<'l'>(batch_size) ^ vector<'j'>(n));
+
+		auto p = p_bag.get_ref();
+		auto q = q_bag.get_ref();
+
+		// the row sweep: v_rows (l x j) holds v[j, i0 - 1 + l], u_rows (l x j) receives u[i0 + l, j]
+		auto v_rows_bag = make_bag(scalar<num_t>() ^ vector<'l'>(batch_size + 2) ^ vector<'j'>(n));
+		auto u_rows_bag = make_bag(scalar<num_t>() ^ vector<'l'>(batch_size) ^ vector<'j'>(n));
+
+		auto v_rows = v_rows_bag.get_ref();
+		auto u_rows = u_rows_bag.get_ref();
+
+		for (std::size_t t = 0; t < tsteps; ++t) {
+			// column sweep
+			#pragma omp for schedule(static)
+			for (std::size_t i0 = 1; i0 < n - 1; i0 += batch_size) {
+				const std::size_t lanes = std::min(batch_size, n - 1 - i0);
+
+				#pragma omp simd
+				for (std::size_t l = 0; l < lanes; ++l) {
+					v[idx<'i'>(i0 + l) & idx<'j'>(0)] = (num_t)1.0;
+					p[idx<'l'>(l) & idx<'j'>(0)] = (num_t)0.0;
+					q[idx<'l'>(l) & idx<'j'>(0)] = v[idx<'i'>(i0 + l) & idx<'j'>(0)];
+				}
+
+				for (std::size_t j = 1; j < n - 1; ++j) {
+					#pragma omp simd
+					for (std::size_t l = 0; l < lanes; ++l) {
+						const std::size_t i = i0 + l;
+
+						p[idx<'l'>(l) & idx<'j'>(j)] = -c / (a * p[idx<'l'>(l) & idx<'j'>(j - 1)] + b);
+						q[idx<'l'>(l) & idx<'j'>(j)] = (-d * u[idx<'i'>(j) & idx<'j'>(i - 1)] + (B2 + B1 * d) * u[idx<'i'>(j) & idx<'j'>(i)] -
+										f * u[idx<'i'>(j) & idx<'j'>(i + 1)] -
+										a * q[idx<'l'>(l) & idx<'j'>(j - 1)]) /
+									(a * p[idx<'l'>(l) & idx<'j'>(j - 1)] + b);
+					}
+				}
+
+				#pragma omp simd
+				for (std::size_t l = 0; l < lanes; ++l)
+					v[idx<'i'>(i0 + l) & idx<'j'>(n - 1)] = (num_t)1.0;
+
+				for (std::size_t j = n - 2; j >= 1; --j) {
+					#pragma omp simd
+					for (std::size_t l = 0; l < lanes; ++l)
+						v[idx<'i'>(i0 + l) & idx<'j'>(j)] =
+							p[idx<'l'>(l) & idx<'j'>(j)] * v[idx<'i'>(i0 + l) & idx<'j'>(j + 1)] + q[idx<'l'>(l) & idx<'j'>(j)];
+				}
+			}
+
+			// row sweep
+			#pragma omp for schedule(static)
+			for (std::size_t i0 = 1; i0 < n - 1; i0 += batch_size) {
+				const std::size_t lanes = std::min(batch_size, n - 1 - i0);
+
+				#pragma omp simd
+				for (std::size_t l = 0; l < lanes; ++l) {
+					u[idx<'i'>(i0 + l) & idx<'j'>(0)] = (num_t)1.0;
+					p[idx<'l'>(l) & idx<'j'>(0)] = (num_t)0.0;
+					q[idx<'l'>(l) & idx<'j'>(0)] = u[idx<'i'>(i0 + l) & idx<'j'>(0)];
+				}
+
+				// the neighbouring rows of v as well (i0 - 1 and i0 + lanes)
+				for (std::size_t l = 0; l < lanes + 2; ++l)
+					for (std::size_t j = 0; j < n; ++j)
+						v_rows[idx<'l'>(l) & idx<'j'>(j)] = v[idx<'i'>(j) & idx<'j'>(i0 - 1 + l)];
+
+				for (std::size_t j = 1; j < n - 1; ++j) {
+					#pragma omp simd
+					for (std::size_t l = 0; l < lanes; ++l) {
+						p[idx<'l'>(l) & idx<'j'>(j)] = -f / (d * p[idx<'l'>(l) & idx<'j'>(j - 1)] + e);
+						q[idx<'l'>(l) & idx<'j'>(j)] = (-a * v_rows[idx<'l'>(l) & idx<'j'>(j)] + (B2 + B1 * a) * v_rows[idx<'l'>(l + 1) & idx<'j'>(j)] -
+										c * v_rows[idx<'l'>(l + 2) & idx<'j'>(j)] -
+										d * q[idx<'l'>(l) & idx<'j'>(j - 1)]) /
+									(d * p[idx<'l'>(l) & idx<'j'>(j - 1)] + e);
+					}
+				}
+
+				#pragma omp simd
+				for (std::size_t l = 0; l < lanes; ++l) {
+					u[idx<'i'>(i0 + l) & idx<'j'>(n - 1)] = (num_t)1.0;
+					u_rows[idx<'l'>(l) & idx<'j'>(n - 1)] = (num_t)1.0;
+				}
+
+				for (std::size_t j = n - 2; j >= 1; --j) {
+					#pragma omp simd
+					for (std::size_t l = 0; l < lanes; ++l)
+						u_rows[idx<'l'>(l) & idx<'j'>(j)] =
+							p[idx<'l'>(l) & idx<'j'>(j)] * u_rows[idx<'l'>(l) & idx<'j'>(j + 1)] + q[idx<'l'>(l) & idx<'j'>(j)];
+				}
+
+				for (std::size_t l = 0; l < lanes; ++l)
+					for (std::size_t j = 1; j < n - 1; ++j)
+						u[idx<'i'>(i0 + l) & idx<'j'>(j)] = u_rows[idx<'l'>(l) & idx<'j'>(j)];
+			}
+		}
+	}
+}
+
+// floating-point operations of kernel_adi
+constexpr double flop_count(std::size_t n, std::size_t t) {
+	return 30.0 * t * (n - 2.0) * (n - 2.0);
+}
 
-	auto duration = std::chrono::duration<long double>(end - start);
+// compulsory memory traffic of kernel_adi in bytes (inputs read and outputs written once)
+constexpr double byte_count(std::size_t n, std::size_t) {
+	return sizeof(num_t) * 2.0 * n * n;
+}
+
+} // namespace
+
+int KERNEL_MAIN(int argc, char *argv[]) {
+	using namespace std::string_literals;
+
+	// benchmark parameters
+	polybench::params params(argc, argv);
+
+	// the sizes of the selected variant
+	if (tuning.batched) {
+		polybench::require_tuning_size("batch_size", tuning.batch_size);
+	}
+
+	// problem size
+	std::size_t n = params.size("N", N);
+	std::size_t t = params.size("TSTEPS", TSTEPS);
+
+	polybench::affinity affinity(params);
+	polybench::memory memory(params);
+
+	// data (u and v partitioned into the batches of kernel_adi_batched)
+	auto u = memory.make_bag(noarr::scalar<num_t>() ^ tuning.u_layout ^ noarr::set_length<'i'>(n) ^ noarr::set_length<'j'>(n),
+		polybench::partition<'i'>{tuning.batch_size});
+	auto v = memory.make_bag(noarr::scalar<num_t>() ^ tuning.v_layout ^ noarr::set_length<'i'>(n) ^ noarr::set_length<'j'>(n),
+		polybench::partition<'i'>{tuning.batch_size});
+	auto p = memory.make_bag(noarr::scalar<num_t>() ^ tuning.p_layout ^ noarr::set_length<'i'>(n) ^ noarr::set_length<'j'>(n));
+	auto q = memory.make_bag(noarr::scalar<num_t>() ^ tuning.q_layout ^ noarr::set_length<'i'>(n) ^ noarr::set_length<'j'>(n));
+
+	polybench::harness harness("adi", params);
+
+	harness
+		.length("n", n)
+		.length("t", t)
+		.tuning("u_layout", tuning.u_layout)
+		.tuning("v_layout", tuning.v_layout)
+		.tuning("p_layout", tuning.p_layout)
+		.tuning("q_layout", tuning.q_layout)
+		.tuning("batched", tuning.batched)
+		.tuning("batch_size", tuning.batch_size)
+		.environment(affinity.settings())
+		.environment(memory.settings())
+		.flops(flop_count(n, t))
+		.bytes(byte_count(n, t));
+
+	harness.run([&] {
+		// initialize data
+		init_array(u.get_ref());
+	}, [&] {
+		// run kernel
+		if (tuning.batched)
+			kernel_adi_batched(t, u.get_ref(), v.get_ref(), tuning.batch_size);
+		else
+			kernel_adi(t, u.get_ref(), v.get_ref(), p.get_ref(), q.get_ref());
+	});
 
 	// print results
+	polybench::results results(params);
+
 	if (argc > 0 && argv[0] != ""s) {
-		std::cout << std::fixed << std::setprecision(2);
-		noarr::serialize_data(std::cout, u.get_ref() ^ noarr::hoist<'i'>());
+		if (results.text()) {
+			std::cout << std::fixed << std::setprecision(2);
+			noarr::serialize_data(std::cout, u.get_ref() ^ noarr::hoist<'i'>());
+		}
+		else {
+			results.write<'i', 'j'>("u", u.get_ref());
+		}
 	}
 
-	std::cerr << std::fixed << std::setprecision(6);
-	std::cerr << duration.count() << std::endl;
+	harness.environment(memory.placement());
+	harness.report(std::cerr);
+	memory.report(std::cerr);
+
+	return 0;
 }
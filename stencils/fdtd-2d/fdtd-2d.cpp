@@ -1,10 +1,14 @@
-#include <chrono>
 #include <iomanip>
 #include <iostream>
 
 #include <noarr/traversers.hpp>
 
 #include "defines.hpp"
+#include "params.hpp"
+#include "harness.hpp"
+#include "affinity.hpp"
+#include "memory.hpp"
+#include "results.hpp"
 #include "fdtd-2d.hpp"
 
 using num_t = DATA_TYPE;
@@ -15,9 +19,13 @@ constexpr auto i_vec = noarr::vector<'i'>();
 constexpr auto j_vec = noarr::vector<'j'>();
 
 struct tuning {
+#ifdef TUNING_HEADER
+# include TUNING_HEADER
+#else
 	DEFINE_PROTO_STRUCT(ex_layout, j_vec ^ i_vec);
 	DEFINE_PROTO_STRUCT(ey_layout, j_vec ^ i_vec);
 	DEFINE_PROTO_STRUCT(hz_layout, j_vec ^ i_vec);
+#endif
 } tuning;
 
 // initialization function
@@ -83,42 +91,80 @@ void kernel_fdtd_2d(auto ex, auto ey, auto hz, auto _fict_) {
 	#pragma endscop
 }
 
-} // namespace
-
-int main(int argc, char *argv[]) {
-	using namespace std::string_literals;
+// floating-point operations of kernel_fdtd_2d
+constexpr double flop_count(std::size_t t, std::size_t ni, std::size_t nj) {
+	return t * (3.0 * (ni - 1.0) * nj + 3.0 * ni * (nj - 1.0) + 5.0 * (ni - 1.0) * (nj - 1.0));
+}
 
-	// problem size
-	std::size_t t = TMAX;
-	std::size_t ni = NI;
-	std::size_t nj = NJ;
+// compulsory memory traffic of kernel_fdtd_2d in bytes (inputs read and outputs written once)
+constexpr double byte_count(std::size_t t, std::size_t ni, std::size_t nj) {
+	return sizeof(num_t) * (6.0 * ni * nj + t);
+}
 
-	// data
-	auto ex = noarr::make_bag(noarr::scalar<num_t>() ^ tuning.ex_layout ^ noarr::set_length<'i'>(ni) ^ noarr::set_length<'j'>(nj));
-	auto ey = noarr::make_bag(noarr::scalar<num_t>() ^ tuning.ey_layout ^ noarr::set_length<'i'>(ni) ^ noarr::set_length<'j'>(nj));
-	auto hz = noarr::make_bag(noarr::scalar<num_t>() ^ tuning.hz_layout ^ noarr::set_length<'i'>(ni) ^ noarr::set_length<'j'>(nj));
-	auto _fict_ = noarr::make_bag(noarr::scalar<num_t>() ^ noarr::vector<'t'>(t));
+} // namespace
 
-	// initialize data
-	init_array(ex.get_ref(), ey.get_ref(), hz.get_ref(), _fict_.get_ref());
+int KERNEL_MAIN(int argc, char *argv[]) {
+	using namespace std::string_literals;
 
-	auto start = std::chrono::high_resolution_clock::now();
+	// benchmark parameters
+	polybench::params params(argc, argv);
 
-	// run kernel
-	kernel_fdtd_2d(ex.get_ref(), ey.get_ref(), hz.get_ref(), _fict_.get_ref());
+	// problem size
+	std::size_t t = params.size("TMAX", TMAX);
+	std::size_t ni = params.size("NI", NI);
+	std::size_t nj = params.size("NJ", NJ);
 
-	auto end = std::chrono::high_resolution_clock::now();
+	polybench::affinity affinity(params);
+	polybench::memory memory(params);
 
-	auto duration = std::chrono::duration<long double>(end - start);
+	// data
+	auto ex = memory.make_bag(noarr::scalar<num_t>() ^ tuning.ex_layout ^ noarr::set_length<'i'>(ni) ^ noarr::set_length<'j'>(nj));
+	auto ey = memory.make_bag(noarr::scalar<num_t>() ^ tuning.ey_layout ^ noarr::set_length<'i'>(ni) ^ noarr::set_length<'j'>(nj));
+	auto hz = memory.make_bag(noarr::scalar<num_t>() ^ tuning.hz_layout ^ noarr::set_length<'i'>(ni) ^ noarr::set_length<'j'>(nj));
+	auto _fict_ = memory.make_bag(noarr::scalar<num_t>() ^ noarr::vector<'t'>(t));
+
+	polybench::harness harness("fdtd-2d", params);
+
+	harness
+		.length("t", t)
+		.length("ni", ni)
+		.length("nj", nj)
+		.tuning("ex_layout", tuning.ex_layout)
+		.tuning("ey_layout", tuning.ey_layout)
+		.tuning("hz_layout", tuning.hz_layout)
+		.environment(affinity.settings())
+		.environment(memory.settings())
+		.flops(flop_count(t, ni, nj))
+		.bytes(byte_count(t, ni, nj));
+
+	harness.run([&] {
+		// initialize data
+		init_array(ex.get_ref(), ey.get_ref(), hz.get_ref(), _fict_.get_ref());
+	}, [&] {
+		// run kernel
+		kernel_fdtd_2d(ex.get_ref(), ey.get_ref(), hz.get_ref(), _fict_.get_ref());
+	});
 
 	// print results
+	polybench::results results(params);
+
 	if (argc > 0 && argv[0] != ""s) {
-		std::cout << std::fixed << std::setprecision(2);
-		noarr::serialize_data(std::cout, ex.get_ref() ^ noarr::hoist<'i'>());
-		noarr::serialize_data(std::cout, ey.get_ref() ^ noarr::hoist<'i'>());
-		noarr::serialize_data(std::cout, hz.get_ref() ^ noarr::hoist<'i'>());
+		if (results.text()) {
+			std::cout << std::fixed << std::setprecision(2);
+			noarr::serialize_data(std::cout, ex.get_ref() ^ noarr::hoist<'i'>());
+			noarr::serialize_data(std::cout, ey.get_ref() ^ noarr::hoist<'i'>());
+			noarr::serialize_data(std::cout, hz.get_ref() ^ noarr::hoist<'i'>());
+		}
+		else {
+			results.write<'i', 'j'>("ex", ex.get_ref());
+			results.write<'i', 'j'>("ey", ey.get_ref());
+			results.write<'i', 'j'>("hz", hz.get_ref());
+		}
 	}
 
-	std::cerr << std::fixed << std::setprecision(6);
-	std::cerr << duration.count() << std::endl;
+	harness.environment(memory.placement());
+	harness.report(std::cerr);
+	memory.report(std::cerr);
+
+	return 0;
 }
@@ -1,10 +1,16 @@
-#include <chrono>
+#include <algorithm>
+#include <cstddef>
 #include <iomanip>
 #include <iostream>
 
 #include <noarr/traversers.hpp>
 
 #include "defines.hpp"
+#include "params.hpp"
+#include "harness.hpp"
+#include "affinity.hpp"
+#include "memory.hpp"
+#include "results.hpp"
 #include "heat-3d.hpp"
 
 using num_t = DATA_TYPE;
@@ -16,6 +22,9 @@ constexpr auto j_vec = noarr::vector<'j'>();
 constexpr auto k_vec = noarr::vector<'k'>();
 
 struct tuning {
+#ifdef TUNING_HEADER
+# include TUNING_HEADER
+#else
 	DEFINE_PROTO_STRUCT(block_i, noarr::hoist<'i'>());
 	DEFINE_PROTO_STRUCT(block_j, noarr::hoist<'j'>());
 	DEFINE_PROTO_STRUCT(block_k, noarr::hoist<'k'>());
@@ -24,6 +33,12 @@ struct tuning {
 
 	DEFINE_PROTO_STRUCT(a_layout, k_vec ^ j_vec ^ i_vec);
 	DEFINE_PROTO_STRUCT(b_layout, k_vec ^ j_vec ^ i_vec);
+
+	// kernel_heat_3d_tiled: bands of tile_t time steps, tiles of tile_i rows (skewed in time)
+	AUTO_FIELD(time_tiled, false);
+	AUTO_FIELD(tile_t, (std::size_t)4);
+	AUTO_FIELD(tile_i, (std::size_t)8);
+#endif
 } tuning;
 
 // initialization function
@@ -83,39 +98,170 @@ void kernel_heat_3d(std::size_t tsteps, auto A, auto B, Order order = {}) {
 	#pragma endscop
 }
 
+// a single half-step of kernel_heat_3d restricted to the traversed part of the grid
+[[gnu::always_inline]]
+inline void heat_3d_step(auto dst, auto src, auto trav) {
+	// dst: i x j x k
+	// src: i x j x k
+	using namespace noarr;
+
+	trav | [=](auto state) {
+		dst[state] =
+			(num_t).125 * (src[state - idx<'i'>(1)] -
+			               2 * src[state] +
+			               src[state + idx<'i'>(1)]) +
+			(num_t).125 * (src[state - idx<'j'>(1)] -
+			               2 * src[state] +
+			               src[state + idx<'j'>(1)]) +
+			(num_t).125 * (src[state - idx<'k'>(1)] -
+			               2 * src[state] +
+			               src[state + idx<'k'>(1)]) +
+			src[state];
+	};
+}
+
+// time-tiled multi-threaded computation kernel
+//
+// The half-steps (B from A, then A from B) are grouped into bands of 2 * tile_t.
+// Within a band, the rows are cut into tiles of tile_i rows shifted back by one
+// row per half-step, so a tile depends only on the preceding tile of its band and
+// on nearby tiles of the preceding band. The tiles are executed in wavefronts,
+// the tiles of a wavefront are far enough apart to run in parallel, and every
+// element is computed from the same values as in kernel_heat_3d.
+[[gnu::flatten, gnu::noinline]]
+void kernel_heat_3d_tiled(std::size_t tsteps, auto A, auto B, std::size_t tile_t, std::size_t tile_i) {
+	// A: i x j x k
+	// B: i x j x k
+	using namespace noarr;
+
+	const std::size_t n = A | get_length<'i'>();
+
+	if (n < 3)
+		return;
+
+	const std::size_t steps = 2 * tsteps;
+	const std::size_t band = 2 * tile_t;
+	const std::size_t width = tile_i;
+
+	const std::size_t bands = (steps + band - 1) / band;
+	const std::size_t tiles = (n - 2 + band - 1) / width + 1;
+
+	// the tiles of a wavefront are `distance` tiles apart in consecutive bands
+	const std::size_t distance = (band + 1) / width + 2;
+	const std::size_t waves = bands ? tiles + distance * (bands - 1) : 0;
+
+	auto trav = traverser(A, B) ^ span<'j'>(1, n - 1) ^ span<'k'>(1, n - 1);
+
+	#pragma omp parallel
+	for (std::size_t wave = 0; wave < waves; ++wave) {
+		#pragma omp for schedule(dynamic)
+		for (std::size_t q = 0; q < bands; ++q) {
+			if (wave < distance * q || wave - distance * q >= tiles)
+				continue;
+
+			const std::size_t b = wave - distance * q;
+			const std::size_t s0 = q * band, s1 = std::min(s0 + band, steps);
+
+			for (std::size_t s = s0; s < s1; ++s) {
+				// rows [b * width, (b + 1) * width) shifted back by s - s0, clipped to the interior
+				const std::size_t lo = std::max<std::ptrdiff_t>(1, (std::ptrdiff_t)(b * width) - (std::ptrdiff_t)(s - s0));
+				const std::size_t hi = std::min<std::ptrdiff_t>(n - 1, (std::ptrdiff_t)((b + 1) * width) - (std::ptrdiff_t)(s - s0));
+
+				if (lo >= hi)
+					continue;
+
+				if (s % 2 == 0)
+					heat_3d_step(B, A, trav ^ span<'i'>(lo, hi));
+				else
+					heat_3d_step(A, B, trav ^ span<'i'>(lo, hi));
+			}
+		}
+	}
+}
+
+// floating-point operations of kernel_heat_3d
+constexpr double flop_count(std::size_t n, std::size_t t) {
+	return 30.0 * t * (n - 2.0) * (n - 2.0) * (n - 2.0);
+}
+
+// compulsory memory traffic of kernel_heat_3d in bytes (inputs read and outputs written once)
+constexpr double byte_count(std::size_t n, std::size_t) {
+	return sizeof(num_t) * 3.0 * n * n * n;
+}
+
 } // namespace
 
-int main(int argc, char *argv[]) {
+int KERNEL_MAIN(int argc, char *argv[]) {
 	using namespace std::string_literals;
 
+	// benchmark parameters
+	polybench::params params(argc, argv);
+
+	// the sizes of the selected variant
+	if (tuning.time_tiled) {
+		polybench::require_tuning_size("tile_t", tuning.tile_t);
+		polybench::require_tuning_size("tile_i", tuning.tile_i);
+	}
+
 	// problem size
-	std::size_t n = N;
-	std::size_t t = TSTEPS;
+	std::size_t n = params.size("N", N);
+	std::size_t t = params.size("TSTEPS", TSTEPS);
 
 	auto set_lengths = noarr::set_length<'i'>(n) ^ noarr::set_length<'j'>(n) ^ noarr::set_length<'k'>(n);
 
-	// data
-	auto A = noarr::make_bag(noarr::scalar<num_t>() ^ tuning.a_layout ^ set_lengths);
-	auto B = noarr::make_bag(noarr::scalar<num_t>() ^ tuning.b_layout ^ set_lengths);
-
-	// initialize data
-	init_array(A.get_ref(), B.get_ref());
+	polybench::affinity affinity(params);
+	polybench::memory memory(params);
 
-	auto start = std::chrono::high_resolution_clock::now();
+	// data
+	auto A = memory.make_bag(noarr::scalar<num_t>() ^ tuning.a_layout ^ set_lengths);
+	auto B = memory.make_bag(noarr::scalar<num_t>() ^ tuning.b_layout ^ set_lengths);
 
-	// run kernel
-	kernel_heat_3d(t, A.get_ref(), B.get_ref(), tuning.order);
+	polybench::harness harness("heat-3d", params);
 
-	auto end = std::chrono::high_resolution_clock::now();
+	harness
+		.length("n", n)
+		.length("t", t)
+		.tuning("block_i", tuning.block_i)
+		.tuning("block_j", tuning.block_j)
+		.tuning("block_k", tuning.block_k)
+		.tuning("order", tuning.order)
+		.tuning("a_layout", tuning.a_layout)
+		.tuning("b_layout", tuning.b_layout)
+		.tuning("time_tiled", tuning.time_tiled)
+		.tuning("tile_t", tuning.tile_t)
+		.tuning("tile_i", tuning.tile_i)
+		.environment(affinity.settings())
+		.environment(memory.settings())
+		.flops(flop_count(n, t))
+		.bytes(byte_count(n, t));
 
-	auto duration = std::chrono::duration<long double>(end - start);
+	harness.run([&] {
+		// initialize data
+		init_array(A.get_ref(), B.get_ref());
+	}, [&] {
+		// run kernel
+		if (tuning.time_tiled)
+			kernel_heat_3d_tiled(t, A.get_ref(), B.get_ref(), tuning.tile_t, tuning.tile_i);
+		else
+			kernel_heat_3d(t, A.get_ref(), B.get_ref(), tuning.order);
+	});
 
 	// print results
+	polybench::results results(params);
+
 	if (argc > 0 && argv[0] != ""s) {
-		std::cout << std::fixed << std::setprecision(2);
-		noarr::serialize_data(std::cout, A.get_ref() ^ noarr::reorder<'i', 'j', 'k'>());
+		if (results.text()) {
+			std::cout << std::fixed << std::setprecision(2);
+			noarr::serialize_data(std::cout, A.get_ref() ^ noarr::reorder<'i', 'j', 'k'>());
+		}
+		else {
+			results.write<'i', 'j', 'k'>("A", A.get_ref());
+		}
 	}
 
-	std::cerr << std::fixed << std::setprecision(6);
-	std::cerr << duration.count() << std::endl;
+	harness.environment(memory.placement());
+	harness.report(std::cerr);
+	memory.report(std::cerr);
+
+	return 0;
 }
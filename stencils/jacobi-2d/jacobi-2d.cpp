@@ -1,10 +1,14 @@
-#include <chrono>
 #include <iomanip>
 #include <iostream>
 
 #include <noarr/traversers.hpp>
 
 #include "defines.hpp"
+#include "params.hpp"
+#include "harness.hpp"
+#include "affinity.hpp"
+#include "memory.hpp"
+#include "results.hpp"
 #include "jacobi-2d.hpp"
 
 using num_t = DATA_TYPE;
@@ -15,6 +19,9 @@ constexpr auto i_vec = noarr::vector<'i'>();
 constexpr auto j_vec = noarr::vector<'j'>();
 
 struct tuning {
+#ifdef TUNING_HEADER
+# include TUNING_HEADER
+#else
 	DEFINE_PROTO_STRUCT(block_i, noarr::neutral_proto());
 	DEFINE_PROTO_STRUCT(block_j, noarr::neutral_proto());
 
@@ -22,6 +29,7 @@ struct tuning {
 
 	DEFINE_PROTO_STRUCT(a_layout, j_vec ^ i_vec);
 	DEFINE_PROTO_STRUCT(b_layout, j_vec ^ i_vec);
+#endif
 } tuning;
 
 
@@ -75,37 +83,74 @@ void kernel_jacobi_2d(std::size_t tsteps, auto A, auto B, Order order = {}) {
 	#pragma endscop
 }
 
-} // namespace
-
-int main(int argc, char *argv[]) {
-	using namespace std::string_literals;
+// floating-point operations of kernel_jacobi_2d
+constexpr double flop_count(std::size_t n, std::size_t t) {
+	return 10.0 * t * (n - 2.0) * (n - 2.0);
+}
 
-	// problem size
-	std::size_t n = N;
-	std::size_t t = TSTEPS;
+// compulsory memory traffic of kernel_jacobi_2d in bytes (inputs read and outputs written once)
+constexpr double byte_count(std::size_t n, std::size_t) {
+	return sizeof(num_t) * 3.0 * n * n;
+}
 
-	// data
-	auto A = noarr::make_bag(noarr::scalar<num_t>() ^ tuning.a_layout ^ noarr::set_length<'i'>(n) ^ noarr::set_length<'j'>(n));
-	auto B = noarr::make_bag(noarr::scalar<num_t>() ^ tuning.b_layout ^ noarr::set_length<'i'>(n) ^ noarr::set_length<'j'>(n));
+} // namespace
 
-	// initialize data
-	init_array(A.get_ref(), B.get_ref());
+int KERNEL_MAIN(int argc, char *argv[]) {
+	using namespace std::string_literals;
 
-	auto start = std::chrono::high_resolution_clock::now();
+	// benchmark parameters
+	polybench::params params(argc, argv);
 
-	// run kernel
-	kernel_jacobi_2d(t, A.get_ref(), B.get_ref(), tuning.order);
+	// problem size
+	std::size_t n = params.size("N", N);
+	std::size_t t = params.size("TSTEPS", TSTEPS);
 
-	auto end = std::chrono::high_resolution_clock::now();
+	polybench::affinity affinity(params);
+	polybench::memory memory(params);
 
-	auto duration = std::chrono::duration<long double>(end - start);
+	// data
+	auto A = memory.make_bag(noarr::scalar<num_t>() ^ tuning.a_layout ^ noarr::set_length<'i'>(n) ^ noarr::set_length<'j'>(n));
+	auto B = memory.make_bag(noarr::scalar<num_t>() ^ tuning.b_layout ^ noarr::set_length<'i'>(n) ^ noarr::set_length<'j'>(n));
+
+	polybench::harness harness("jacobi-2d", params);
+
+	harness
+		.length("n", n)
+		.length("t", t)
+		.tuning("block_i", tuning.block_i)
+		.tuning("block_j", tuning.block_j)
+		.tuning("order", tuning.order)
+		.tuning("a_layout", tuning.a_layout)
+		.tuning("b_layout", tuning.b_layout)
+		.environment(affinity.settings())
+		.environment(memory.settings())
+		.flops(flop_count(n, t))
+		.bytes(byte_count(n, t));
+
+	harness.run([&] {
+		// initialize data
+		init_array(A.get_ref(), B.get_ref());
+	}, [&] {
+		// run kernel
+		kernel_jacobi_2d(t, A.get_ref(), B.get_ref(), tuning.order);
+	});
 
 	// print results
+	polybench::results results(params);
+
 	if (argc > 0 && argv[0] != ""s) {
-		std::cout << std::fixed << std::setprecision(2);
-		noarr::serialize_data(std::cout, A.get_ref() ^ noarr::hoist<'i'>());
+		if (results.text()) {
+			std::cout << std::fixed << std::setprecision(2);
+			noarr::serialize_data(std::cout, A.get_ref() ^ noarr::hoist<'i'>());
+		}
+		else {
+			results.write<'i', 'j'>("A", A.get_ref());
+		}
 	}
 
-	std::cerr << std::fixed << std::setprecision(6);
-	std::cerr << duration.count() << std::endl;
+	harness.environment(memory.placement());
+	harness.report(std::cerr);
+	memory.report(std::cerr);
+
+	return 0;
 }
@@ -1,10 +1,14 @@
-#include <chrono>
 #include <iomanip>
 #include <iostream>
 
 #include <noarr/traversers.hpp>
 
 #include "defines.hpp"
+#include "params.hpp"
+#include "harness.hpp"
+#include "affinity.hpp"
+#include "memory.hpp"
+#include "results.hpp"
 #include "seidel-2d.hpp"
 
 using num_t = DATA_TYPE;
@@ -15,7 +19,11 @@ constexpr auto i_vec = noarr::vector<'i'>();
 constexpr auto j_vec = noarr::vector<'j'>();
 
 struct tuning {
+#ifdef TUNING_HEADER
+# include TUNING_HEADER
+#else
 	DEFINE_PROTO_STRUCT(a_layout, j_vec ^ i_vec);
+#endif
 } tuning;
 
 // initialization function
@@ -56,36 +64,69 @@ void kernel_seidel_2d(std::size_t tsteps, auto A) {
 	#pragma endscop
 }
 
-} // namespace
-
-int main(int argc, char *argv[]) {
-	using namespace std::string_literals;
+// floating-point operations of kernel_seidel_2d
+constexpr double flop_count(std::size_t n, std::size_t t) {
+	return 9.0 * t * (n - 2.0) * (n - 2.0);
+}
 
-	// problem size
-	std::size_t n = N;
-	std::size_t t = TSTEPS;
+// compulsory memory traffic of kernel_seidel_2d in bytes (inputs read and outputs written once)
+constexpr double byte_count(std::size_t n, std::size_t) {
+	return sizeof(num_t) * 2.0 * n * n;
+}
 
-	// data
-	auto A = noarr::make_bag(noarr::scalar<num_t>() ^ tuning.a_layout ^ noarr::set_length<'i'>(n) ^ noarr::set_length<'j'>(n));
+} // namespace
 
-	// initialize data
-	init_array(A.get_ref());
+int KERNEL_MAIN(int argc, char *argv[]) {
+	using namespace std::string_literals;
 
-	auto start = std::chrono::high_resolution_clock::now();
+	// benchmark parameters
+	polybench::params params(argc, argv);
 
-	// run kernel
-	kernel_seidel_2d(t, A.get_ref());
+	// problem size
+	std::size_t n = params.size("N", N);
+	std::size_t t = params.size("TSTEPS", TSTEPS);
 
-	auto end = std::chrono::high_resolution_clock::now();
+	polybench::affinity affinity(params);
+	polybench::memory memory(params);
 
-	auto duration = std::chrono::duration<long double>(end - start);
+	// data
+	auto A = memory.make_bag(noarr::scalar<num_t>() ^ tuning.a_layout ^ noarr::set_length<'i'>(n) ^ noarr::set_length<'j'>(n));
+
+	polybench::harness harness("seidel-2d", params);
+
+	harness
+		.length("n", n)
+		.length("t", t)
+		.tuning("a_layout", tuning.a_layout)
+		.environment(affinity.settings())
+		.environment(memory.settings())
+		.flops(flop_count(n, t))
+		.bytes(byte_count(n, t));
+
+	harness.run([&] {
+		// initialize data
+		init_array(A.get_ref());
+	}, [&] {
+		// run kernel
+		kernel_seidel_2d(t, A.get_ref());
+	});
 
 	// print results
+	polybench::results results(params);
+
 	if (argc > 0 && argv[0] != ""s) {
-		std::cout << std::fixed << std::setprecision(2);
-		noarr::serialize_data(std::cout, A.get_ref() ^ noarr::hoist<'i'>());
+		if (results.text()) {
+			std::cout << std::fixed << std::setprecision(2);
+			noarr::serialize_data(std::cout, A.get_ref() ^ noarr::hoist<'i'>());
+		}
+		else {
+			results.write<'i', 'j'>("A", A.get_ref());
+		}
 	}
 
-	std::cerr << std::fixed << std::setprecision(6);
-	std::cerr << duration.count() << std::endl;
+	harness.environment(memory.placement());
+	harness.report(std::cerr);
+	memory.report(std::cerr);
+
+	return 0;
 }